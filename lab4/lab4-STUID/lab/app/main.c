@@ -1,9 +1,5 @@
 #include "lib.h"
 #include "types.h"
-#define HUNGRY 0
-#define EATING 1
-#define THINKING 2
-void test(int i,int *now_state,sem_t* forks);
 
 
 int uEntry(void) {
@@ -21,6 +17,7 @@ int uEntry(void) {
 		printf("Ret: %d; %c, %s, %d, %x.\n", ret, cha, str, dec, hex);
 		if (ret == 4)
 			break;
+		while ((ret = getchar()) != '\n' && ret != EOF); // drop the rest of the bad line
 	}
 	
 	// For lab4.2
@@ -72,24 +69,16 @@ int uEntry(void) {
 	//任意P、V及思考、就餐之间，添加sleep(128)
 
 /*
-	int now_state[5];
 	sem_t forks[5];
-	sem_t mutex;
 
-	//【step1：信号量初始化+状态初始化,forks和mutex。在创建子进程之前完成，保证只初始化一次！】
+	//【step1：信号量初始化,每根筷子一个信号量，初值为1。在创建子进程之前完成，保证只初始化一次！】
+	//XXX：semop可以一次性拿起左右两根筷子（要么都拿到，要么都不拿），不再需要全局mutex和test()
 	for(int i=0;i<5;i++){
-		int result_1 = sem_init(&forks[i],0);
+		int result_1 = sem_init(&forks[i],1);
 		if(result_1<0)
 			{printf("something wrong with initializing semaphores forks\n");exit();}
 	}
 
-	int result_2 = sem_init(&mutex,1);
-	if(result_2<0)
-		{printf("something wrong with initializing semaphores(lock) mutex\n");exit();}
-
-	for(int i=0;i<5;i++)
-		now_state[i]=THINKING;
-
 	//【step2：创建五个哲学家，确定当前哲学家的编号cur_ph】
 	int cur_ph;//XXX：指示当前的进程是谁,不是pid！！！而是五个哲学家中的编号(0-4)！
 	pid_t new_ph;//XXX：指示新的进程是谁，是pid！！！
@@ -104,42 +93,41 @@ int uEntry(void) {
 	}
 
 	//【step3：开始思考吃饭】
+	struct sembuf take[2];
+	struct sembuf put[2];
+	take[0].sem = forks[cur_ph];		take[0].op = -1;
+	take[1].sem = forks[(cur_ph+1)%5];	take[1].op = -1;
+	put[0].sem = forks[cur_ph];		put[0].op = 1;
+	put[1].sem = forks[(cur_ph+1)%5];	put[1].op = 1;
 	for(int i=0;i<5;i++){
 
 	printf("Philosopher %d:think\n",cur_ph);
 	sleep(128);
 
-	sem_wait(&mutex);
-	now_state[cur_ph] = HUNGRY;
-	test(cur_ph,now_state,forks);//此时已经同时拿上左右筷子开始吃啦！
-	sem_post(&mutex);
-	sem_wait(&forks[cur_ph]);
+	semop(take,2);//此时已经同时拿上左右筷子开始吃啦！
 	printf("Philosopher %d:eat\n",cur_ph);
 	sleep(128);
 	
-	sem_wait(&mutex);
-	now_state[cur_ph] = THINKING;
-	int left_c = (cur_ph-1>=0)?(cur_ph-1):(cur_ph+4);
-	int right_c = (cur_ph+1>4)?(cur_ph-4):(cur_ph+1);
-	test(left_c,now_state,forks);
-	test(right_c,now_state,forks);//此时sem_post操作中会有时间中断来重新调度的呢！
-	sem_post(&mutex);
+	semop(put,2);//放下筷子会唤醒等在这两根筷子上的邻居，由他们自己重新检查
 	}
 	printf("finishing think&eat,philosopher %d is released\n",cur_ph);
-	sem_destroy(&forks[cur_ph]);
 	exit();
 */
-	return 0;
-}
-
 
-void test(int i,int *now_state,sem_t* forks){
-	int left = (i-1>=0)?(i-1):(i+4);
-	int right = (i+1>4)?(i-4):(i+1);
-	if(now_state[i]==HUNGRY && now_state[left]!=EATING && now_state[right]!=EATING){
-		now_state[i]=EATING;
-		sem_post(&forks[i]);
-	}
-		
+	// Formatting benchmark: cycles per snprintf of a typical log line
+/*
+	char line[128];
+	uint32_t lo, hi, start;
+	int n, len = 0;
+	asm volatile("rdtsc" : "=a"(start), "=d"(hi));
+	for (n = 0; n < 10000; n++)
+		len += snprintf(line, sizeof(line), "pid %d tick %u addr %p val %08x %lld\n",
+			n, n * 7u, (void *)line, n * 2654435761u, (long long)n * 1000000007LL);
+	asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+	printf("snprintf: %u cycles/call, %u bytes/Kcycle\n", (lo - start) / 10000,
+		(uint32_t)len * 1000u / (lo - start));
+	exit();
+*/
+	return 0;
 }
 
@@ -1,4 +1,5 @@
 #include "boot.h"
+#include "string.h" // lib/string.h
 
 #define SECTSIZE 512
 
@@ -19,9 +20,7 @@ void bootMain(void) {
 	phoff = ((struct ELFHeader *)elf)->phoff;
 	offset = ((struct ProgramHeader *)(elf + phoff))->off;
 
-	for (i = 0; i < 200 * 512; i++) {
-		*(unsigned char *)(elf + i) = *(unsigned char *)(elf + i + offset);
-	}
+	memmove((void*)elf, (void*)(elf + offset), 200 * 512);
 
 	kMainEntry();
 }
@@ -4,5 +4,8 @@
 #include "common/types.h"
 #include "common/const.h"
 #include "common/assert.h"
+#include "common/printk.h"
+#include "format.h" // lib/format.h, shared with user space
+#include "string.h" // lib/string.h, likewise
 
 #endif
@@ -0,0 +1,22 @@
+#ifndef __PRINTK_H__
+#define __PRINTK_H__
+
+#define KERN_ERR 3
+#define KERN_WARN 4
+#define KERN_INFO 6
+#define KERN_DEBUG 7
+
+#define LOG_CONSOLE_LEVEL KERN_INFO // levels up to this one also go to serial
+
+/* formats into the log ring without blocking, serial gets it later */
+void printk(int level, const char *fmt, ...);
+
+/* drains the log to serial right now, for interrupts off (abort) */
+void printkFlush(void);
+
+void printkSoftirq(void);
+
+/* copies the newest size bytes the log still holds, returns the count */
+int printkRead(char *dst, int size);
+
+#endif
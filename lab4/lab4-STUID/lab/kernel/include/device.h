@@ -6,5 +6,6 @@
 #include "device/vga.h"
 #include "device/timer.h"
 #include "device/keyboard.h"
+#include "device/tty.h"
 
 #endif
@@ -3,5 +3,9 @@
 
 void initSerial(void);
 void putChar(char);
+void serialWrite(const char *str, int size);
+void serialIntr(void);
+int serialGetChar(char *ch); // 0: nothing received
+void serialFlush(void); // interrupts off: send everything queued by polling
 
 #endif
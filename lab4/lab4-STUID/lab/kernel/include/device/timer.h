@@ -1,6 +1,9 @@
 #ifndef __TIMER_H__
 #define __TIMER_H__
 
+#define HZ 100
+//#define HZ 1000
+
 void initTimer();
 
 #endif
@@ -0,0 +1,24 @@
+#ifndef __TTY_H__
+#define __TTY_H__
+
+void initTty();
+
+/* feeds one typed character ('\b' erases), returns 1 when it ends a line */
+int ttyInput(char c);
+
+/* copies at most size bytes of finished input, stopping after a '\n' */
+int ttyRead(char *dst, int size);
+
+/* where stdout and the echo go, a bit mask */
+#define CONSOLE_VGA 1
+#define CONSOLE_SERIAL 2
+
+#ifndef CONSOLE_DEFAULT
+#define CONSOLE_DEFAULT CONSOLE_VGA
+#endif
+
+extern int consoleMode;
+
+void consoleWrite(const char *str, int size);
+
+#endif
@@ -7,6 +7,10 @@
 void initVga();
 void clearScreen();
 void updateCursor(int row, int col);
+void putCell(int row, int col, uint16_t data);
+void vgaWrite(const char *str, int size);
+void markCursor();
+void flushCursor();
 void scrollScreen();
 
 #endif
@@ -7,8 +7,23 @@
 #include "x86/irq.h"
 
 void initSeg(void);
+void initSysenter(void);
+void initPage(void);
+void initVdso(void);
 void initSem(void);
+void initFutex(void);
+void initShm(void);
+void initPipe(void);
 void initDev(void);
 void initProc(void);
 
+uint32_t segBase(uint32_t sel);
+void *userAddr(uint32_t sel, uint32_t addr, uint32_t size);
+void mapPages(uint32_t linear, uint32_t phys, uint32_t size, uint32_t perm);
+uint32_t linearToPhys(uint32_t linear);
+
+void vdsoStart(int pid);
+void vdsoTick(void);
+void vdsoSwitch(int pid);
+
 #endif
@@ -27,6 +27,40 @@ static inline void disableInterrupt(void) {
 	asm volatile("cli");
 }
 
+#define CPUID_TSC 0x10 // rdtsc
+#define CPUID_SEP 0x800 // sysenter/sysexit
+
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+/* CPUID 1号功能的edx，没有CPUID指令（EFLAGS.ID翻不动）时为0 */
+static inline uint32_t cpuidFeatures(void) {
+	uint32_t a, b, c, d, flags;
+	asm volatile("pushfl; popl %0; movl %0, %1; xorl $0x200000, %0;"
+		"pushl %0; popfl; pushfl; popl %0; pushl %1; popfl"
+		: "=&r"(a), "=&r"(flags));
+	if (((a ^ flags) & 0x200000) == 0)
+		return 0;
+	asm volatile("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1));
+	/* Pentium Pro 报告了SEP却不支持 */
+	if (((a >> 8) & 0xf) == 6 && ((a >> 4) & 0xf) < 3 && (a & 0xf) < 3)
+		d &= ~CPUID_SEP;
+	return d;
+}
+
+/* 写MSR */
+static inline void writeMsr(uint32_t msr, uint32_t value) {
+	asm volatile("wrmsr" : : "c"(msr), "a"(value), "d"(0));
+}
+
+/* 读CR2，缺页时出错的线性地址 */
+static inline uint32_t readCr2(void) {
+	uint32_t addr;
+	asm volatile("movl %%cr2, %0" : "=r"(addr));
+	return addr;
+}
+
 #define NR_IRQ    256
 
 #endif
@@ -5,4 +5,18 @@
 void initIdt(void);
 void initIntr(void);
 
+/* 下半部：硬中断只记录事件，耗时的处理在开中断后做 */
+#define SOFTIRQ_KEYBOARD 0 // translate, buffer & echo the queued scancodes
+#define SOFTIRQ_SERIAL 1 // feed the bytes received on COM1 to the tty
+#define SOFTIRQ_PRINTK 2 // send new kernel log records to serial
+#define NR_SOFTIRQ 3
+
+extern volatile int softirqActive;
+
+void raiseSoftirq(int nr);
+void doSoftirq(void);
+
+void keyboardSoftirq(void);
+void serialSoftirq(void);
+
 #endif
@@ -49,19 +49,105 @@ struct ListHead {
 
 #define MAX_SEM_NUM 6
 
+#define SEM_HIST_NUM 8
+
+struct SemStat {
+	uint32_t waits; // wait, timedwait and semop decrements
+	uint32_t contended; // times a waiter had to block
+	uint32_t posts;
+	uint32_t maxQueue; // most processes ever blocked on pcb and opWait together
+	uint32_t blockedTicks; // timer ticks spent blocked, summed over all waits
+	uint32_t hist[SEM_HIST_NUM]; // waits that took 0, 1, 2-3, 4-7, ..., 64+ ticks
+};
+typedef struct SemStat SemStat;
+
 struct Semaphore {
 	int state;
 	int value;
 	struct ListHead pcb; // link to all pcb ListHead blocked on this semaphore
+	struct ListHead opWait; // link to all pcb ListHead blocked in semop on this semaphore
+	struct ListHead poll; // link to all PollWait of processes polling this semaphore
+	struct SemStat stat; // reset by sem_init, kept after sem_destroy
 };
 typedef struct Semaphore Semaphore;
 
+struct SemOp {
+	int sem; // index in sem[]
+	int op; // <0: wait for -op units; >0: post op units
+};
+typedef struct SemOp SemOp;
+
+#define MAX_FUTEX_NUM 8
+
+struct Futex {
+	int state;
+	uint32_t key; // physical address of the user word this futex is keyed on
+	int value; // >0: pending wakeups; <0: number of blocked processes
+	struct ListHead pcb; // link to all pcb ListHead blocked on this futex
+};
+typedef struct Futex Futex;
+
+#define MAX_SHM_NUM 4
+#define SHM_SIZE 0x10000 // bytes per shared memory segment
+#define SHM_BASE 0x80000 // shm[i] is attached at SHM_BASE+i*SHM_SIZE in every user segment
+#define SHM_PHYS 0xa00000 // physical memory backing shm[i], above the last user segment
+
+#define VDSO_BASE 0x7e000 // read-only in every user segment: VdsoData, then VdsoProc
+#define VDSO_PHYS (SHM_PHYS + MAX_SHM_NUM*SHM_SIZE) // the one VdsoData page
+
+#define HEAP_LIMIT VDSO_BASE // sbrk never moves the break into the vdso or shm pages
+
+struct VdsoData {
+	uint32_t seq; // odd while the kernel is updating the page
+	uint32_t hz; // ticks per second
+	uint32_t ticks; // timer ticks since boot
+	uint32_t tscLow, tscHigh; // TSC at the last tick
+	uint32_t tscPerTick; // 0 until calibrated, or without a TSC
+	uint32_t switches; // process switches since boot
+	uint32_t idleTicks; // ticks that found the idle process running
+	uint32_t runnable; // user processes ready or running at the last tick
+	uint32_t blocked; // and blocked
+};
+typedef struct VdsoData VdsoData;
+
+struct VdsoProc {
+	uint32_t pid;
+	uint32_t ticks; // ticks that found this process running
+	uint32_t switches; // times it was switched to
+};
+typedef struct VdsoProc VdsoProc;
+
+struct Shm {
+	int state;
+	uint32_t size;
+	int count; // number of processes it is attached to
+	int creator; // pcb index holding it until the first attach, -1 after
+};
+typedef struct Shm Shm;
+
+#define MAX_PIPE_NUM 4
+#define PIPE_SIZE 1024
+
+struct Pipe {
+	int state;
+	int head; // index of the next byte to read
+	int count; // bytes buffered
+	int readers; // open read ends, over all processes
+	int writers; // open write ends, over all processes
+	struct ListHead readWait; // link to all pcb ListHead blocked reading an empty pipe
+	struct ListHead writeWait; // link to all pcb ListHead blocked writing a full pipe
+	struct ListHead poll; // link to all PollWait of processes polling either end
+	uint8_t buffer[PIPE_SIZE];
+};
+typedef struct Pipe Pipe;
+
 #define MAX_DEV_NUM 6
 
 struct Device {
 	int state;
 	int value;
 	struct ListHead pcb; // link to all pcb ListHead blocked on this device
+	struct ListHead poll; // link to all PollWait of processes polling this device
 };
 typedef struct Device Device;
 
@@ -75,6 +161,63 @@ typedef struct Device Device;
 
 #define MAX_TIME_COUNT 16
 
+#define MAX_FD_NUM 8 // 0: STD_OUT, 1: STD_IN, the rest are pipe ends
+#define FD_FIRST 2
+#define PIPE_READ 0
+#define PIPE_WRITE 1
+
+#define MAX_POLL_NUM 8
+
+#define POLLIN 0x1 // stdin/pipe has data, or the semaphore is positive
+#define POLLOUT 0x4 // stdout, or the pipe has room
+#define POLLHUP 0x10 // the other end of the pipe is closed
+#define POLLNVAL 0x20 // bad fd or semaphore
+#define POLLSEM 0x100 // in events: fd is a sem[] index, not a file descriptor
+
+struct PollFd {
+	int fd;
+	int events;
+	int revents;
+};
+typedef struct PollFd PollFd;
+
+struct PollWait {
+	struct ListHead link; // on the poll list of a device, semaphore or pipe
+	int pid;
+};
+
+#define IPC_NONE 0
+#define IPC_RECV 1 // in ipc_reply_wait, waiting for a call
+#define IPC_SEND 2 // in ipc_call, queued until the server receives
+#define IPC_REPLY 3 // in ipc_call, message delivered, waiting for the reply
+
+#define RING_SIZE 16
+#define RING_WRITE 0 // a1 fd, a2 buf, a3 size
+#define RING_SEM_POST 1 // a1 sem[] index
+#define RING_SEM_TRYWAIT 2 // a1 sem[] index
+#define RING_SLEEP 3 // a1 ticks
+
+struct RingSqe {
+	uint32_t op;
+	uint32_t a1, a2, a3;
+	uint32_t data; // copied to the completion
+};
+typedef struct RingSqe RingSqe;
+
+struct RingCqe {
+	int32_t res; // what the system call would have returned
+	uint32_t data;
+};
+typedef struct RingCqe RingCqe;
+
+struct Ring {
+	uint32_t sqHead, sqTail; // the kernel advances sqHead, the process sqTail
+	uint32_t cqHead, cqTail; // the process advances cqHead, the kernel cqTail
+	RingSqe sq[RING_SIZE];
+	RingCqe cq[RING_SIZE];
+};
+typedef struct Ring Ring;
+
 struct ProcessTable {
 	uint32_t stack[MAX_STACK_SIZE];
 	struct StackFrame regs;
@@ -86,9 +229,25 @@ struct ProcessTable {
 	uint32_t pid;
 	char name[32];
 	struct ListHead blocked; // sempahore, device, file blocked on
+	uint32_t shmMask; // bit i set: shm[i] is attached
+	int waitSem; // sem[] index of a timed wait in progress, -1: none
+	int fd[MAX_FD_NUM]; // -1: closed; pipe index*2+PIPE_READ/PIPE_WRITE
+	int ipcState; // IPC_NONE, IPC_RECV, IPC_SEND, IPC_REPLY
+	int ipcPartner; // server of a pending ipc_call
+	struct ListHead ipcSenders; // link to all pcb ListHead blocked calling this process
+	struct PollWait pollWait[MAX_POLL_NUM]; // linked only while blocked in poll
+	uint32_t brk; // end of the heap, between uMainEnd and HEAP_LIMIT
+	uint32_t ring; // user address of the registered Ring, 0: none
 };
 typedef struct ProcessTable ProcessTable;
 
+// Page directory/table entry bits
+#define PTE_P       0x1         // Present
+#define PTE_W       0x2         // Writeable
+#define PTE_U       0x4         // User accessible
+#define PG_SIZE     0x1000
+#define NR_PAGETABLE 4          // page tables identity mapping the low 16MB
+
 /*
 1. The number of bits in a bit field sets the limit to the range of values it can hold
 2. Multiple adjacent bit fields are usually packed together (although this behavior is implementation-defined)
@@ -148,6 +307,23 @@ static inline void setGdt(SegDesc *gdt, uint32_t size) {
 	asm volatile("lgdt (%0)" : : "r"(data));
 }
 
+static inline void setCr3(uint32_t pageDir) {
+	asm volatile("movl %0, %%cr3" :: "r"(pageDir));
+}
+
+static inline void enablePaging(void) {
+	uint32_t cr0;
+	asm volatile("movl %%cr0, %0" : "=r"(cr0));
+	asm volatile("movl %0, %%cr0" :: "r"(cr0 | 0x80000000));
+}
+
+/* reloading cr3 flushes the TLB, invlpg is not available on i386 */
+static inline void flushTlb(void) {
+	uint32_t cr3;
+	asm volatile("movl %%cr3, %0" : "=r"(cr3));
+	asm volatile("movl %0, %%cr3" :: "r"(cr3));
+}
+
 static inline void lLdt(uint16_t sel)
 {
 	asm volatile("lldt %0" :: "r"(sel));
@@ -45,7 +45,9 @@ void irqAlignCheck(); // 0x11
 void irqSecException(); // 0x1e
 void irqTimer();
 void irqKeyboard();
+void irqSerial();
 void irqSyscall();
+void irqSchedule();
 
 void initIdt() {
 	int i;
@@ -69,11 +71,13 @@ void initIdt() {
 	
 	setIntr(idt + 0x20, SEG_KCODE, (uint32_t)irqTimer, DPL_KERN);
 	setIntr(idt + 0x21, SEG_KCODE, (uint32_t)irqKeyboard, DPL_KERN);
+	setIntr(idt + 0x24, SEG_KCODE, (uint32_t)irqSerial, DPL_KERN); // COM1
 	/* Exceptions with DPL = 3 */
 	//setIntr(idt + 0x3, SEG_KCODE, , DPL_USER); // for int 3, interrupt vector is 0x3, Interruption is disabled
 	//setIntr(idt + 0x4, SEG_KCODE, , DPL_USER); // for into, interrupt vector is 0x4, Interruption is disabled
 	//setIntr(idt + 0x5, SEG_KCODE, , DPL_USER); // for bound, interrupt vector is 0x5, Interruption is disabled
 	setIntr(idt + 0x80, SEG_KCODE, (uint32_t)irqSyscall, DPL_USER); // for int 0x80, interrupt vector is 0x80, Interruption is disabled
+	setIntr(idt + 0x81, SEG_KCODE, (uint32_t)irqSchedule, DPL_KERN); // for int 0x81, kernel-only reschedule
 
 	/* 写入IDT */
 	saveIdt(idt, sizeof(idt));
@@ -8,6 +8,16 @@
 #define SYS_SLEEP 4
 #define SYS_EXIT 5
 #define SYS_SEM 6
+#define SYS_FUTEX 7
+#define SYS_SHM 8
+#define SYS_PIPE 9
+#define SYS_CLOSE 10
+#define SYS_IPC 11
+#define SYS_POLL 12
+#define SYS_CONSOLE 13
+#define SYS_KLOG 14
+#define SYS_SBRK 15
+#define SYS_RING 16
 
 #define STD_OUT 0
 #define STD_IN 1
@@ -16,6 +26,28 @@
 #define SEM_WAIT 1
 #define SEM_POST 2
 #define SEM_DESTROY 3
+#define SEM_OP 4
+#define SEM_TIMEDWAIT 5
+#define SEM_STAT 6
+#define SEM_TRYWAIT 7
+
+#define SEM_TIMEOUT 1
+
+#define SEM_WAKE 0 // woken waiter just becomes runnable, the poster keeps the CPU
+#define SEM_HANDOFF 1 // switch to the woken waiter right away
+
+#define IPC_CALL 0
+#define IPC_REPLY_WAIT 1
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+#define SHM_CREATE 0
+#define SHM_ATTACH 1
+#define SHM_DETACH 2
+
+#define RING_SETUP 0
+#define RING_ENTER 1
 
 extern TSS tss;
 
@@ -23,17 +55,21 @@ extern ProcessTable pcb[MAX_PCB_NUM];
 extern int current;
 
 extern Semaphore sem[MAX_SEM_NUM];
+extern Futex futex[MAX_FUTEX_NUM];
+extern Shm shm[MAX_SHM_NUM];
+extern Pipe pipe[MAX_PIPE_NUM];
 extern Device dev[MAX_DEV_NUM];
 
-extern int displayRow;
-extern int displayCol;
+extern uint32_t tickCount;
+extern uint32_t uMainEnd;
+
 
-extern uint32_t keyBuffer[MAX_KEYBUFFER_SIZE];
-extern int bufferHead;
-extern int bufferTail;
+void switchProc(int i);
 
 void GProtectFaultHandle(struct StackFrame *sf);
+void pageFaultHandle(struct StackFrame *sf);
 void timerHandle(struct StackFrame *sf);
+void scheduleHandle(struct StackFrame *sf);
 void keyboardHandle(struct StackFrame *sf);
 void syscallHandle(struct StackFrame *sf);
 
@@ -44,19 +80,81 @@ void syscallExec(struct StackFrame *sf);
 void syscallSleep(struct StackFrame *sf);
 void syscallExit(struct StackFrame *sf);
 void syscallSem(struct StackFrame *sf);
+void syscallFutex(struct StackFrame *sf);
+void syscallShm(struct StackFrame *sf);
+void syscallPipe(struct StackFrame *sf);
+void syscallClose(struct StackFrame *sf);
+void syscallIpc(struct StackFrame *sf);
+void syscallPoll(struct StackFrame *sf);
+void syscallConsole(struct StackFrame *sf);
+void syscallKlog(struct StackFrame *sf);
+void syscallSbrk(struct StackFrame *sf);
+void syscallRing(struct StackFrame *sf);
 
 void syscallWriteStdOut(struct StackFrame *sf);
+void syscallWritePipe(struct StackFrame *sf);
 
 void syscallReadStdIn(struct StackFrame *sf);
+void syscallReadPipe(struct StackFrame *sf);
 
 void syscallSemInit(struct StackFrame *sf);
 void syscallSemWait(struct StackFrame *sf);
 void syscallSemPost(struct StackFrame *sf);
 void syscallSemDestroy(struct StackFrame *sf);
+void syscallSemOp(struct StackFrame *sf);
+void syscallSemTimedWait(struct StackFrame *sf);
+void syscallSemStat(struct StackFrame *sf);
+void syscallSemTryWait(struct StackFrame *sf);
+
+static void semTimeout(int i);
+
+static void semWakeOps(int i);
+static void semStatBlock(int i);
+static void semStatWait(int i, uint32_t start);
+
+void syscallFutexWait(struct StackFrame *sf);
+void syscallFutexWake(struct StackFrame *sf);
+
+void syscallIpcCall(struct StackFrame *sf);
+void syscallIpcReplyWait(struct StackFrame *sf);
+
+void syscallShmCreate(struct StackFrame *sf);
+void syscallShmAttach(struct StackFrame *sf);
+void syscallShmDetach(struct StackFrame *sf);
+
+void syscallRingSetup(struct StackFrame *sf);
+void syscallRingEnter(struct StackFrame *sf);
+
+static void shmMap(int pid, int id);
+static void shmUnmap(int pid, int id);
+
+static void sleepOn(struct ListHead *queue);
+static void wakeAll(struct ListHead *queue);
+static void pollWake(struct ListHead *queue);
+static void stdinWake();
+static void stdinLines(int line);
+static void pipeClose(int pid, int fd);
+static void ipcAbort(int pid);
+
+/* sysenter keeps no return state: cs/ss are the current process's and the
+ * lib stub left its return eip on top of the user stack. Without a usable
+ * stack the call becomes an exit */
+void sysenterFrame(struct StackFrame *sf) {
+	uint32_t *ret = NULL;
+	sf->cs = USEL(1+current*2);
+	sf->ss = USEL(2+current*2);
+	ret = (uint32_t*)userAddr(sf->ss, sf->esp, 4);
+	if (ret == NULL) {
+		sf->eax = SYS_EXIT;
+		return;
+	}
+	sf->eip = *ret;
+	sf->esp += 4;
+}
 
 void irqHandle(struct StackFrame *sf) { // pointer sf = esp
-	/* Reassign segment register */
-	asm volatile("movw %%ax, %%ds"::"a"(KSEL(SEG_KDATA)));
+	/* Reassign segment register, es too for string instructions */
+	asm volatile("movw %%ax, %%ds; movw %%ax, %%es"::"a"(KSEL(SEG_KDATA)));
 	/* Save esp to stackTop */
 	uint32_t tmpStackTop = pcb[current].stackTop;
 	pcb[current].prevStackTop = pcb[current].stackTop;
@@ -68,17 +166,27 @@ void irqHandle(struct StackFrame *sf) { // pointer sf = esp
 		case 0xd:
 			GProtectFaultHandle(sf);
 			break;
+		case 0xe:
+			pageFaultHandle(sf);
+			break;
 		case 0x20:
 			timerHandle(sf);
 			break;
+		case 0x81:
+			scheduleHandle(sf);
+			break;
 		case 0x21:
 			keyboardHandle(sf);
 			break;
+		case 0x24:
+			serialIntr();
+			break;
 		case 0x80:
 			syscallHandle(sf);
 			break;
 		default:assert(0);
 	}
+	doSoftirq();
 	/* Recover stackTop */
 	pcb[current].stackTop = tmpStackTop;
 }
@@ -88,15 +196,58 @@ void GProtectFaultHandle(struct StackFrame *sf) {
 	return;
 }
 
+/* a user access to a page it may not touch (a store to the read-only vdso
+ * pages) kills the process, retrying it would fault forever; one in the
+ * kernel is a bug */
+void pageFaultHandle(struct StackFrame *sf) {
+	uint32_t addr = readCr2();
+	if ((sf->cs & 0x3) == DPL_KERN) {
+		printk(KERN_ERR, "page fault at %x in the kernel, eip %x error %x\n", addr, sf->eip, sf->error);
+		assert(0);
+	}
+	printk(KERN_WARN, "pid %d: page fault at %x, eip %x error %x, killed\n",
+		pcb[current].pid, addr - segBase(USEL(2+current*2)), sf->eip, sf->error);
+	syscallExit(sf);
+}
+
+/* make process i current and return from the interrupt it was switched out in,
+ * does not return to the caller */
+void switchProc(int i) {
+	uint32_t tmpStackTop;
+	if (i != current)
+		vdsoSwitch(i);
+	current = i;
+	/* echo pid of selected process */
+	//putChar('0'+current);
+	pcb[current].state = STATE_RUNNING;
+	/* recover stackTop of selected process */
+	tmpStackTop = pcb[current].stackTop;
+	pcb[current].stackTop = pcb[current].prevStackTop;
+	tss.esp0 = (uint32_t)&(pcb[current].stackTop); // setting tss for user process
+	asm volatile("movl %0, %%esp"::"m"(tmpStackTop)); // switch kernel stack
+	asm volatile("popl %gs");
+	asm volatile("popl %fs");
+	asm volatile("popl %es");
+	asm volatile("popl %ds");
+	asm volatile("popal");
+	asm volatile("addl $8, %esp");
+	asm volatile("iret");
+}
+
 void timerHandle(struct StackFrame *sf) {
 	int i;
-	uint32_t tmpStackTop;
+	tickCount++;
+	flushCursor();
+	vdsoTick();
 	i = (current+1) % MAX_PCB_NUM;
 	while (i != current) {
 		if (pcb[i].state == STATE_BLOCKED && pcb[i].sleepTime != -1) {
 			pcb[i].sleepTime --;
-			if (pcb[i].sleepTime == 0)
+			if (pcb[i].sleepTime == 0) {
+				if (pcb[i].waitSem != -1) // sem_timedwait expired before any post
+					semTimeout(i);
 				pcb[i].state = STATE_RUNNABLE;
+			}
 		}
 		i = (i+1) % MAX_PCB_NUM;
 	}
@@ -106,114 +257,106 @@ void timerHandle(struct StackFrame *sf) {
 		pcb[current].timeCount++;
 		return;
 	}
-	else {
-		if (pcb[current].state == STATE_RUNNING) {
-			pcb[current].state = STATE_RUNNABLE;
-			pcb[current].timeCount = 0;
-		}
-		
-		i = (current+1) % MAX_PCB_NUM;
-		while (i != current) {
-			if (i !=0 && pcb[i].state == STATE_RUNNABLE)
-				break;
-			i = (i+1) % MAX_PCB_NUM;
-		}
-		if (pcb[i].state != STATE_RUNNABLE)
-			i = 0;
-		current = i;
-		/* echo pid of selected process */
-		//putChar('0'+current);
-		pcb[current].state = STATE_RUNNING;
-		pcb[current].timeCount = 1;
-		/* recover stackTop of selected process */
-		tmpStackTop = pcb[current].stackTop;
-		pcb[current].stackTop = pcb[current].prevStackTop;
-		tss.esp0 = (uint32_t)&(pcb[current].stackTop); // setting tss for user process
-		asm volatile("movl %0, %%esp"::"m"(tmpStackTop)); // switch kernel stack
-		asm volatile("popl %gs");
-		asm volatile("popl %fs");
-		asm volatile("popl %es");
-		asm volatile("popl %ds");
-		asm volatile("popal");
-		asm volatile("addl $8, %esp");
-		asm volatile("iret");
-	}
-}
-
-void keyboardHandle(struct StackFrame *sf) {//【格式化读入---写buffer=键盘中断】
-//每按下一个按键就会触发一次键盘中断，每次只需要把恩下的那一个键的keycode放入buffer之中即可！
-	uint32_t keyCode = getKeyCode();
-	if (keyCode == 0) // illegal keyCode
+	else if (softirqActive) // interrupted a softirq, the next tick switches
 		return;
-	//【功能1：把读取到的keycode放入keybuffer之中】------Lab2中的实现
-	//putChar(getChar(keyCode));
-	uint32_t code = getKeyCode();
-	int pos=0;
-	uint16_t data=0;
-	if(code == 0xe){ // 退格符
-		//  要求只能退格用户键盘输入的字符串，且最多退到当行行首
-		if(displayCol>0){
-			displayCol-=1;
-			data = 0 | (0x0c << 8);
-			pos = (80*displayRow+displayCol)*2;
-			asm volatile("movw %0, (%1)"::"r"(data),"r"(pos+0xb8000));
-			
-		}
-	}else if(code == 0x1c){ // 回车符
-		// 处理回车情况
-		keyBuffer[bufferTail++]='\n';//在qemu中进行换行
-		displayRow+=1;
-		displayCol=0;
-		if(displayRow==25){
-			displayRow=24;
-			displayCol=0;
-			scrollScreen();
-		}
-		putChar('\n');//在串口进行换行
-	}else if(code < 0x81){ // 正常字符
-		// 注意输入的大小写的实现、不可打印字符的处理
-		char character=getChar(code);
-		if(character!=0){
-			putChar(character);//向串口中进行输出字符
-			keyBuffer[bufferTail++]=character;//向keyuffer中存字符，未来向qemu中输入
-			bufferTail%=MAX_KEYBUFFER_SIZE;
-			data=character|(0x0c<<8);
-			pos=(80*displayRow+displayCol)*2;
-			asm volatile("movw %0, (%1)"::"r"(data),"r"(pos+0xb8000));
-			displayCol+=1;
-			if(displayCol==80){
-				displayCol=0;
-				displayRow++;
-				if(displayRow==25){
-					displayRow=24;
-					displayCol=0;
-					scrollScreen();
-				}
-			}
-		}
+	else
+		scheduleHandle(sf);
+}
+
+/* int $0x81: kernel code that blocked or killed the current process gives up
+ * the CPU here, without counting a tick or aging the sleepers like int $0x20 */
+void scheduleHandle(struct StackFrame *sf) {
+	int i;
+	if (pcb[current].state == STATE_RUNNING) {
+		pcb[current].state = STATE_RUNNABLE;
+		pcb[current].timeCount = 0;
 	}
-	updateCursor(displayRow, displayCol);
 	
-	//【功能2：V()操作！1、唤醒阻塞在dev[STD_IN]上的一个进程 2、创建资源】最多只能有一个进程被阻塞在dev[STD_IN]上
-	//此时有buffer的输入，有资源可以读入啦！
-	if (dev[STD_IN].state == 1 && dev[STD_IN].value < 0) { // with process blocked,此时需要唤醒他
-		// TODO: deal with blocked situation
-		//【先把他从阻塞列表中拿出来】
-		ProcessTable* pt;
-		pt = (ProcessTable*)((uint32_t)(dev[STD_IN].pcb.prev) - (uint32_t)&(((ProcessTable*)0)->blocked));
-		dev[STD_IN].pcb.prev = (dev[STD_IN].pcb.prev)->prev;
-		(dev[STD_IN].pcb.prev)->next = &(dev[STD_IN].pcb);
-		//【再对他的信息进行修改】
-		pt->state=STATE_RUNNABLE;
-		//pt->timecount=MAX_TIME_COUNT;这两行最好别加，为了保证唤醒后的运行逻辑不发生过改变，原来时间片剩多长时间就运行多久！
-		//pt->sleeptime=0;--------------加这两行也不会错，只是调度会和期望的不同
-		dev[STD_IN].value = 1;//【因为最多只能有一个线程被阻塞，唤醒了之后全部可以读！》》此时有一个字符可以由本读入！！！】
-		asm volatile("int $0x20");//符合逻辑，此时有一个进程被唤醒，发时间中断，看调度器会不会调度他！---------不加应该也没事
+	i = (current+1) % MAX_PCB_NUM;
+	while (i != current) {
+		if (i !=0 && pcb[i].state == STATE_RUNNABLE)
+			break;
+		i = (i+1) % MAX_PCB_NUM;
 	}
-	
+	if (pcb[i].state != STATE_RUNNABLE)
+		i = 0;
+	pcb[i].timeCount = 1;
+	switchProc(i);
+}
+
+/* scancodes on their way from keyboardHandle to keyboardSoftirq, one writer
+ * and one reader so no lock is needed */
+#define SCAN_RING_SIZE 32
+static uint8_t scanRing[SCAN_RING_SIZE];
+static volatile int scanHead = 0;
+static volatile int scanTail = 0;
+
+void keyboardHandle(struct StackFrame *sf) {//【键盘中断只读一次扫描码放进scanRing，其余交给keyboardSoftirq】
+	uint32_t code = getKeyCode();
+	if (code == 0) // illegal keyCode
+		return;
+	if ((scanTail + 1) % SCAN_RING_SIZE != scanHead) { // full: drop the key
+		scanRing[scanTail] = code;
+		scanTail = (scanTail + 1) % SCAN_RING_SIZE;
+	}
+	raiseSoftirq(SOFTIRQ_KEYBOARD);
 	return;
 }
 
+void keyboardSoftirq(void) {//【格式化读入---写buffer】行编辑和回显都交给tty，开着中断做
+	uint32_t code = 0;
+	char character = 0;
+	int line = 0;
+	while (scanHead != scanTail) {
+		code = scanRing[scanHead];
+		scanHead = (scanHead + 1) % SCAN_RING_SIZE;
+		character = 0;
+		if(code == 0xe) // 退格符
+			character = '\b';
+		else if(code == 0x1c) // 回车符
+			character = '\n';
+		else if(code < 0x81) // 正常字符，大小写在getChar里处理，不可打印字符返回0
+			character = getChar(code);
+		if(character != 0)
+			line += ttyInput(character);
+	}
+	stdinLines(line);
+}
+
+/* bytes typed on the serial console feed the same tty as the keyboard, a
+ * terminal sends '\r' for Enter and DEL or ^H for backspace */
+void serialSoftirq(void) {
+	static int lastCr = 0;
+	char character = 0;
+	int line = 0;
+	while (serialGetChar(&character)) {
+		if (character == '\n' && lastCr) { // '\r\n' from a script is one Enter
+			lastCr = 0;
+			continue;
+		}
+		lastCr = (character == '\r');
+		if (character == '\r')
+			character = '\n';
+		else if (character == 0x7f || character == 0x08)
+			character = '\b';
+		else if (character < ' ' && character != '\n' && character != '\t')
+			continue;
+		line += ttyInput(character);
+	}
+	stdinLines(line);
+}
+
+/* a whole line was completed: hand finished lines to the oldest blocked readers and pollers */
+static void stdinLines(int line) {
+	if (line == 0)
+		return;
+ disableInterrupt();
+	dev[STD_IN].value += line;
+	stdinWake();
+	pollWake(&(dev[STD_IN].poll));
+enableInterrupt();
+}
+
 void syscallHandle(struct StackFrame *sf) {
 	switch(sf->eax) { // syscall number
 		case SYS_WRITE:
@@ -237,6 +380,36 @@ void syscallHandle(struct StackFrame *sf) {
 		case SYS_SEM:
 			syscallSem(sf);
 			break; // for SYS_SEM
+		case SYS_FUTEX:
+			syscallFutex(sf);
+			break; // for SYS_FUTEX
+		case SYS_SHM:
+			syscallShm(sf);
+			break; // for SYS_SHM
+		case SYS_PIPE:
+			syscallPipe(sf);
+			break; // for SYS_PIPE
+		case SYS_CLOSE:
+			syscallClose(sf);
+			break; // for SYS_CLOSE
+		case SYS_IPC:
+			syscallIpc(sf);
+			break; // for SYS_IPC
+		case SYS_POLL:
+			syscallPoll(sf);
+			break; // for SYS_POLL
+		case SYS_CONSOLE:
+			syscallConsole(sf);
+			break; // for SYS_CONSOLE
+		case SYS_KLOG:
+			syscallKlog(sf);
+			break; // for SYS_KLOG
+		case SYS_SBRK:
+			syscallSbrk(sf);
+			break; // for SYS_SBRK
+		case SYS_RING:
+			syscallRing(sf);
+			break; // for SYS_RING
 		default:break;
 	}
 }
@@ -247,51 +420,68 @@ void syscallWrite(struct StackFrame *sf) {
 			if (dev[STD_OUT].state == 1)
 				syscallWriteStdOut(sf);
 			break; // for STD_OUT
-		default:break;
+		default:
+			syscallWritePipe(sf);
+			break;
 	}
 }
 
 void syscallWriteStdOut(struct StackFrame *sf) {
-	int sel = sf->ds; // segment selector for user data, need further modification
-	char *str = (char*)sf->edx;
-	int size = sf->ebx;
-	int i = 0;
-	int pos = 0;
-	char character = 0;
-	uint16_t data = 0;
-	asm volatile("movw %0, %%es"::"m"(sel));
-	for (i = 0; i < size; i++) {
-		asm volatile("movb %%es:(%1), %0":"=r"(character):"r"(str+i));
-		if(character == '\n') {
-			displayRow++;
-			displayCol=0;
-			if(displayRow==MAX_ROW){
-				displayRow=MAX_ROW-1;
-				displayCol=0;
-				scrollScreen();
-			}
-		}
-		else {
-			data = character | (0x0c << 8);
-			pos = (MAX_COL*displayRow+displayCol)*2;
-			asm volatile("movw %0, (%1)"::"r"(data),"r"(pos+0xb8000));
-			displayCol++;
-			if(displayCol==MAX_COL){
-				displayRow++;
-				displayCol=0;
-				if(displayRow==MAX_ROW){
-					displayRow=MAX_ROW-1;
-					displayCol=0;
-					scrollScreen();
-				}
-			}
-		}
+	int size = (int)sf->ebx;
+	char *str = NULL;
+	if (size > 0)
+		str = (char*)userAddr(sf->ds, sf->edx, size); // the whole buffer at once, not byte by byte through %es
+	if (str == NULL) {
+		pcb[current].regs.eax = (size == 0) ? 0 : -1;
+		return;
 	}
-	
-	updateCursor(displayRow, displayCol);
+	consoleWrite(str, size);
+	pcb[current].regs.eax = size;
 	return;
 }
 
+/* stdout goes to VGA, COM1 or both (CONSOLE_VGA|CONSOLE_SERIAL), the boot
+ * default is CONSOLE_DEFAULT; mode 0 only asks. Returns the previous mode */
+void syscallConsole(struct StackFrame *sf) {
+	int mode = (int)sf->ecx;
+	if (mode < 0 || mode > (CONSOLE_VGA | CONSOLE_SERIAL)) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	pcb[current].regs.eax = consoleMode;
+	if (mode != 0)
+		consoleMode = mode;
+}
+
+/* copies the newest part of the kernel log, "<level>text\n" records */
+void syscallKlog(struct StackFrame *sf) {
+	int size = (int)sf->edx;
+	char *str = NULL;
+	if (size > 0)
+		str = (char*)userAddr(sf->ds, sf->ecx, size);
+	if (str == NULL) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	pcb[current].regs.eax = printkRead(str, size);
+}
+
+/* moves the break by (int)ecx bytes, zeroing what it grows by; returns the
+ * old break, or -1 if the new one would leave [uMainEnd, HEAP_LIMIT] */
+void syscallSbrk(struct StackFrame *sf) {
+	int incr = (int)sf->ecx;
+	uint32_t old = pcb[current].brk;
+	if ((incr > 0 && incr > HEAP_LIMIT - old) ||
+	    (incr < 0 && -(uint32_t)incr > old - uMainEnd)) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	if (incr > 0)
+		memset(userAddr(sf->ds, old, incr), 0, incr);
+	pcb[current].brk = old + incr;
+	pcb[current].regs.eax = old;
+}
+
 void syscallRead(struct StackFrame *sf) {//【格式化读入---读buffer】
 	switch(sf->ecx) {
 		case STD_IN:
@@ -299,52 +489,63 @@ void syscallRead(struct StackFrame *sf) {//【格式化读入---读buffer】
 				syscallReadStdIn(sf);
 			break; // for STD_IN
 		default:
+			syscallReadPipe(sf);
 			break;
 	}
 }
 
-void syscallReadStdIn(struct StackFrame *sf) {
-	// TODO: complete `stdin`
-	//1、P()操作，消耗资源 + 如果dev[STD_IN].value=0，当前进程阻塞
-	//2、读keybuffer中的数据
-	//dev[STD_IN].value--;【此时value>0的时候是可以读入的字符数量---可以全读完！！！！！value<0的时候是阻塞的数量】
-	
-	if(dev[STD_IN].state ==1 && dev[STD_IN].value < 0){//已经有一个进程阻塞！而且当前又有进程想读》》多个想读，阻塞 && 而且没有资源
-        	pcb[current].regs.eax = -1;//XXX：如果多个进程想读，后来的进程(pcb[current])返回-1。【下面其他情况返回实际读取的字符数】
-		//XXX:为了保证只有一个进程被阻塞在dev[STD_IN]之中，当前进程运行到这里，如果已经value<0就不会被加入到阻塞列表中，而直接给返回值-1！
-        	return;
-    	}
-	else if(dev[STD_IN].state==1 && dev[STD_IN].value==0){//一个进程想读&& 而且没有资源。加入阻塞列表+修改信息
-		pcb[current].blocked.next = dev[STD_IN].pcb.next;
-		pcb[current].blocked.prev = &(dev[STD_IN].pcb);
-		dev[STD_IN].pcb.next = &(pcb[current].blocked);
-		(pcb[current].blocked.next)->prev = &(pcb[current].blocked);
+/*
+ * stdin hands out whole lines: dev[STD_IN].value counts the finished lines
+ * nobody has claimed yet, readers queue FIFO on dev[STD_IN].pcb and
+ * stdinWake() claims a line for the oldest one before waking it. A reader
+ * whose buffer is shorter than the line leaves the rest for the next read;
+ * one with room to spare also takes the lines still unclaimed behind its
+ * own, so a buffered reader drains pasted or piped input in one trap.
+ * Returns the bytes read (whole lines including '\n'), always NUL
+ * terminated, so at most size-1 of them.
+ */
+static void stdinWake() {
+	ProcessTable *pt = NULL;
+	if (dev[STD_IN].value <= 0 || dev[STD_IN].pcb.prev == &(dev[STD_IN].pcb))
+		return;
+	pt = (ProcessTable*)((uint32_t)(dev[STD_IN].pcb.prev) - (uint32_t)&(((ProcessTable*)0)->blocked));
+	dev[STD_IN].pcb.prev = (dev[STD_IN].pcb.prev)->prev;
+	(dev[STD_IN].pcb.prev)->next = &(dev[STD_IN].pcb);
+	pt->state = STATE_RUNNABLE;
+	dev[STD_IN].value--;
+}
 
-		pcb[current].state = STATE_BLOCKED;
-		pcb[current].sleepTime = 0;
-		pcb[current].regs.eax = 0;//XXX：一个进程&没有资源，返回0（一个都读不出来）
+void syscallReadStdIn(struct StackFrame *sf) {
+ disableInterrupt();
+	int size = (int)sf->ebx;
+	char *str = NULL;
+	int n;
+	if (size > 0)
+		str = (char*)userAddr(sf->ds, sf->edx, size);
+	if (str == NULL) {
+		pcb[current].regs.eax = -1;
+		enableInterrupt();
+		return;
+	}
+	if (dev[STD_IN].value > 0) // no reader can be queued while a line is free
 		dev[STD_IN].value--;
-		asm volatile("int $0x20");
-		return ;
+	else {
+		sleepOn(&(dev[STD_IN].pcb));
+		asm volatile("int $0x81"); // back with a line claimed by stdinWake()
 	}
-
-	int sel = sf->ds;
-	char *str = (char *)sf->edx;
-	int size = sf->ebx;
-	int i = 0;
-	char character = 0;
-	asm volatile("movw %0, %%es" ::"m"(sel));
-	for (i = 0; i < size && bufferHead != bufferTail; i++){
-		character = keyBuffer[bufferHead];
-		bufferHead = (bufferHead + 1) % MAX_KEYBUFFER_SIZE;
-		asm volatile("movb %0, %%es:(%1)" ::"r"(character), "r"(str + i));
-	}
-	asm volatile("movb $0x00, %%es:(%0)" ::"r"(str + i));
-	pcb[current].regs.eax = i;//XXX：没有进程阻塞&有资源，返回读入的个数！
-	dev[STD_IN].value=0;
-	return ;
-
-
+	n = ttyRead(str, size - 1);
+	while (n != 0 && str[n-1] == '\n' && n < size - 1 && dev[STD_IN].value > 0) {
+		dev[STD_IN].value--;
+		n += ttyRead(str + n, size - 1 - n);
+	}
+	str[n] = 0;
+	if (n == 0 || str[n-1] != '\n') { // the rest of the line goes to the next reader
+		dev[STD_IN].value++;
+		stdinWake();
+	}
+	pcb[current].regs.eax = n;
+enableInterrupt();
+	return;
 }
 
 void syscallFork(struct StackFrame *sf) {
@@ -354,14 +555,19 @@ void syscallFork(struct StackFrame *sf) {
 			break;
 	}
 	if (i != MAX_PCB_NUM) {
+		/* inherit shared memory before the copy, so that copying the
+		   attached windows writes the shared pages onto themselves
+		 */
+		pcb[i].shmMask = 0;
+		for (j = 0; j < MAX_SHM_NUM; j++) {
+			if (pcb[current].shmMask & (1 << j))
+				shmMap(i, j);
+		}
 		/* copy userspace
 		   enable interrupt
 		 */
 		enableInterrupt();
-		for (j = 0; j < 0x100000; j++) {
-			*(uint8_t *)(j + (i+1)*0x100000) = *(uint8_t *)(j + (current+1)*0x100000);
-			//asm volatile("int $0x20"); // Testing irqTimer during syscall
-		}
+		memcpy((void *)((i+1)*0x100000), (void *)((current+1)*0x100000), 0x100000);
 		/* disable interrupt
 		 */
 		disableInterrupt();
@@ -376,6 +582,22 @@ void syscallFork(struct StackFrame *sf) {
 		pcb[i].timeCount = pcb[current].timeCount;
 		pcb[i].sleepTime = pcb[current].sleepTime;
 		pcb[i].pid = i;
+		pcb[i].waitSem = -1;
+		pcb[i].brk = pcb[current].brk;
+		pcb[i].ring = pcb[current].ring; // the copy of the ring is at the same address
+		vdsoStart(i);
+		pcb[i].ipcState = IPC_NONE;
+		pcb[i].ipcSenders.next = &(pcb[i].ipcSenders);
+		pcb[i].ipcSenders.prev = &(pcb[i].ipcSenders);
+		for (j = 0; j < MAX_FD_NUM; j++) {//子进程继承打开的管道端
+			pcb[i].fd[j] = pcb[current].fd[j];
+			if (pcb[i].fd[j] == -1)
+				continue;
+			if (pcb[i].fd[j] % 2 == PIPE_READ)
+				pipe[pcb[i].fd[j] / 2].readers++;
+			else
+				pipe[pcb[i].fd[j] / 2].writers++;
+		}
 		/* set regs */
 		pcb[i].regs.ss = USEL(2+i*2);
 		pcb[i].regs.esp = pcb[current].regs.esp;
@@ -391,9 +613,9 @@ void syscallFork(struct StackFrame *sf) {
 		pcb[i].regs.esi = pcb[current].regs.esi;
 		pcb[i].regs.edi = pcb[current].regs.edi;
 		pcb[i].regs.ds = USEL(2+i*2);
-		pcb[i].regs.es = pcb[current].regs.es;
-		pcb[i].regs.fs = pcb[current].regs.fs;
-		pcb[i].regs.gs = pcb[current].regs.gs;
+		pcb[i].regs.es = USEL(2+i*2);
+		pcb[i].regs.fs = USEL(2+i*2);
+		pcb[i].regs.gs = USEL(2+i*2);
 		/* set return value */
 		pcb[i].regs.eax = 0;
 		pcb[current].regs.eax = i;
@@ -414,14 +636,26 @@ void syscallSleep(struct StackFrame *sf) {
 	else {
 		pcb[current].state = STATE_BLOCKED;
 		pcb[current].sleepTime = sf->ecx;
-		asm volatile("int $0x20");
+		asm volatile("int $0x81");
 		return;
 	}
 }
 
 void syscallExit(struct StackFrame *sf) {
+	int i;
+	for (i = 0; i < MAX_SHM_NUM; i++) {
+		if (pcb[current].shmMask & (1 << i))
+			shmUnmap(current, i);
+		else if (shm[i].state == 1 && shm[i].creator == current)
+			shm[i].state = 0; // created but never attached
+	}
+	for (i = FD_FIRST; i < MAX_FD_NUM; i++) {
+		if (pcb[current].fd[i] != -1)
+			pipeClose(current, i);
+	}
+	ipcAbort(current);
 	pcb[current].state = STATE_DEAD;
-	asm volatile("int $0x20");
+	asm volatile("int $0x81");
 	return;
 }
 
@@ -441,6 +675,18 @@ void syscallSem(struct StackFrame *sf) {
 		case SEM_DESTROY:
 			syscallSemDestroy(sf);
 			break;
+		case SEM_OP:
+			syscallSemOp(sf);
+			break;
+		case SEM_TIMEDWAIT:
+			syscallSemTimedWait(sf);
+			break;
+		case SEM_STAT:
+			syscallSemStat(sf);
+			break;
+		case SEM_TRYWAIT:
+			syscallSemTryWait(sf);
+			break;
 		default:break;
 	}
 }
@@ -476,7 +722,7 @@ void syscallSemInit(struct StackFrame *sf) {//从sem数组中拿一个出来进
  disableInterrupt();
 
 	int value = (int)sf->edx;//memory.h中定义的是uint32_t类型的,不改会报错
-	int free;
+	int free, i;
     	for (free = 0; free < MAX_SEM_NUM; free++) {
         	if (sem[free].state == 0) 
 			break;
@@ -488,6 +734,15 @@ void syscallSemInit(struct StackFrame *sf) {//从sem数组中拿一个出来进
 		sem[free].value= value;
         	sem[free].pcb.prev = &sem[free].pcb;//kernel初始化的时候两个前后指针都指向自己呢
         	sem[free].pcb.next = &sem[free].pcb;
+		sem[free].opWait.prev = &sem[free].opWait;
+		sem[free].opWait.next = &sem[free].opWait;
+		sem[free].stat.waits = 0;
+		sem[free].stat.contended = 0;
+		sem[free].stat.posts = 0;
+		sem[free].stat.maxQueue = 0;
+		sem[free].stat.blockedTicks = 0;
+		for (i = 0; i < SEM_HIST_NUM; i++)
+			sem[free].stat.hist[i] = 0;
        		pcb[current].regs.eax = free;//下标当作返回值，用户程序能找到
     	}	
 enableInterrupt();
@@ -500,6 +755,7 @@ void syscallSemWait(struct StackFrame *sf) {
  disableInterrupt();
 
 	int index = (int)(sf->edx);
+	uint32_t start = tickCount;
 	if(index < 0 || index >= MAX_SEM_NUM || sem[index].state == 0)
 		pcb[current].regs.eax=-1;
 	else{//此时传入的下标满足。开始执行P操作
@@ -512,8 +768,10 @@ void syscallSemWait(struct StackFrame *sf) {
             		sem[index].pcb.next = &(pcb[current].blocked);
             		(pcb[current].blocked.next)->prev = &(pcb[current].blocked);
             		pcb[current].regs.eax = 0;
-			asm("int $0x20");//引发时间中断，重新调度
+			semStatBlock(index);
+			asm("int $0x81");//引发时间中断，重新调度
 		}
+		semStatWait(index, start);
 	}
 enableInterrupt();
 	return ;
@@ -523,6 +781,7 @@ void syscallSemPost(struct StackFrame *sf) {
 
  disableInterrupt();
 	int i = (int)sf->edx;
+	int mode = (int)sf->ebx;//SEM_WAKE或SEM_HANDOFF
 	ProcessTable *pt = NULL;
 	if (i < 0 || i >= MAX_SEM_NUM || sem[i].state==0) {// TODO: complete other situations
 		pcb[current].regs.eax = -1;
@@ -530,15 +789,24 @@ void syscallSemPost(struct StackFrame *sf) {
 	}
 	
 	//可以执行V
+	pcb[current].regs.eax=0;
+	sem[i].stat.posts++;
 	sem[i].value++;
-	if(sem[i].value <= 0){
+	if(sem[i].value <= 0){//被唤醒的进程已经拿到了这个信号量（value没有变正），不会有人插队
 		pt = (ProcessTable*)((uint32_t)(sem[i].pcb.prev) -(uint32_t)&(((ProcessTable*)0)->blocked));//取出来的进程
 		sem[i].pcb.prev = (sem[i].pcb.prev)->prev;
 		(sem[i].pcb.prev)->next = &(sem[i].pcb);
 		pt->state=STATE_RUNNABLE;
-		pcb[current].regs.eax=0;
-		asm("int $0x20");
+		pt->waitSem=-1;//sem_timedwait等到了，计时器不要再管他
+		//XXX：不再int $0x20：那样会做一次完整的调度，还会让所有睡眠的进程多减一次sleepTime
+		if(mode == SEM_HANDOFF){//直接切到被唤醒的进程，剩下的时间片也给他
+			pcb[current].state=STATE_RUNNABLE;
+			pt->timeCount=pcb[current].timeCount;
+			switchProc(pt->pid);
+		}
 	}
+	else
+		semWakeOps(i);
 enableInterrupt();
 	return ;
 
@@ -547,16 +815,891 @@ enableInterrupt();
 void syscallSemDestroy(struct StackFrame *sf) {//销毁下标是sf->edx的信号量，即恢复原样！
 	// TODO: complete `SemDestroy`
  disableInterrupt();
+	ProcessTable *pt = NULL;
 	int index=(int)(sf->edx);
 	if(index<0 || index >= MAX_SEM_NUM || sem[index].state==0)
 		pcb[current].regs.eax=-1;
 	else{
+		while (sem[index].pcb.next != &(sem[index].pcb)) {//还在等的进程醒来，返回-1
+			pt = (ProcessTable*)((uint32_t)(sem[index].pcb.next) - (uint32_t)&(((ProcessTable*)0)->blocked));
+			sem[index].pcb.next = (sem[index].pcb.next)->next;
+			pt->state = STATE_RUNNABLE;
+			pt->waitSem = -1; // a sem_timedwait's timer must not touch it any more
+			pt->regs.eax = -1;
+		}
 		sem[index].state = 0;
 		sem[index].value =0;
 		sem[index].pcb.next=&(sem[index].pcb);
 		sem[index].pcb.prev=&(sem[index].pcb);
+		semWakeOps(index);//semop里等着的进程醒来后会发现信号量已经不在了
 		pcb[current].regs.eax=0;
 	} 
 enableInterrupt();
 	return;
 }
+
+/*
+ * Futex: the counter itself lives in user memory and is updated with locked
+ * instructions in user space (see fsem_wait/fsem_post in lib/syscall.c).
+ * The kernel is only entered when a process has to block or has to wake a
+ * blocked one, and the wait queue is keyed on the physical address of the
+ * user word, so every process sharing the word (shm) meets on the same queue.
+ * A wake that arrives before the matching wait is remembered in value, so
+ * the race between the user-space decrement and FUTEX_WAIT loses nothing.
+ * A slot is released as soon as it is balanced (value==0, nobody blocked).
+ */
+static int futexKey(struct StackFrame *sf, uint32_t *key) {
+	uint32_t addr = sf->edx;
+	if ((addr & 0x3) != 0 || addr > 0x100000 - 4)
+		return -1;
+	*key = linearToPhys(segBase(sf->ds) + addr); // shared words differ in linear address
+	return 0;
+}
+
+static int futexLookup(uint32_t key) {
+	int i, free = -1;
+	for (i = 0; i < MAX_FUTEX_NUM; i++) {
+		if (futex[i].state == 1 && futex[i].key == key)
+			return i;
+		if (futex[i].state == 0 && free == -1)
+			free = i;
+	}
+	if (free != -1) {
+		futex[free].state = 1;
+		futex[free].key = key;
+		futex[free].value = 0;
+		futex[free].pcb.next = &futex[free].pcb;
+		futex[free].pcb.prev = &futex[free].pcb;
+	}
+	return free;
+}
+
+static void futexRelease(int i) {
+	if (futex[i].value == 0 && futex[i].pcb.next == &futex[i].pcb)
+		futex[i].state = 0;
+}
+
+void syscallFutex(struct StackFrame *sf) {
+	switch(sf->ecx) {
+		case FUTEX_WAIT:
+			syscallFutexWait(sf);
+			break;
+		case FUTEX_WAKE:
+			syscallFutexWake(sf);
+			break;
+		default:
+			pcb[current].regs.eax = -1;
+			break;
+	}
+}
+
+void syscallFutexWait(struct StackFrame *sf) {
+ disableInterrupt();
+	uint32_t key = 0;
+	int index = -1;
+	if (futexKey(sf, &key) == 0)
+		index = futexLookup(key);
+	if (index == -1)
+		pcb[current].regs.eax = -1;
+	else {
+		futex[index].value--;
+		pcb[current].regs.eax = 0;
+		if (futex[index].value < 0) {
+			pcb[current].state = STATE_BLOCKED;
+			pcb[current].sleepTime = 0x7fffffff;
+			pcb[current].blocked.next = futex[index].pcb.next;
+			pcb[current].blocked.prev = &(futex[index].pcb);
+			futex[index].pcb.next = &(pcb[current].blocked);
+			(pcb[current].blocked.next)->prev = &(pcb[current].blocked);
+			asm volatile("int $0x81");
+		}
+		else
+			futexRelease(index); // consumed a wakeup posted in advance
+	}
+enableInterrupt();
+	return;
+}
+
+void syscallFutexWake(struct StackFrame *sf) {
+ disableInterrupt();
+	uint32_t key = 0;
+	int index = -1;
+	ProcessTable *pt = NULL;
+	if (futexKey(sf, &key) == 0)
+		index = futexLookup(key);
+	if (index == -1)
+		pcb[current].regs.eax = -1;
+	else {
+		futex[index].value++;
+		if (futex[index].value <= 0) {
+			pt = (ProcessTable*)((uint32_t)(futex[index].pcb.prev) -
+				(uint32_t)&(((ProcessTable*)0)->blocked));
+			futex[index].pcb.prev = (futex[index].pcb.prev)->prev;
+			(futex[index].pcb.prev)->next = &(futex[index].pcb);
+			pt->state = STATE_RUNNABLE;
+		}
+		futexRelease(index);
+		pcb[current].regs.eax = 0;
+	}
+enableInterrupt();
+	return;
+}
+
+/*
+ * Shared memory: shm[i] is backed by SHM_SIZE bytes at SHM_PHYS+i*SHM_SIZE and
+ * is attached at the same offset SHM_BASE+i*SHM_SIZE of every user segment by
+ * remapping that window's pages, so pointers into it are valid in every
+ * process. Attachments are inherited by fork and dropped by exit, and a
+ * segment is freed once the last process detaches from it, or when its
+ * creator exits before anyone attached it.
+ */
+static void shmMap(int pid, int id) {
+	mapPages(segBase(USEL(2+pid*2)) + SHM_BASE + id*SHM_SIZE, SHM_PHYS + id*SHM_SIZE, SHM_SIZE, PTE_W);
+	pcb[pid].shmMask |= (1 << id);
+	shm[id].count++;
+	shm[id].creator = -1;
+}
+
+static void shmUnmap(int pid, int id) {
+	uint32_t linear = segBase(USEL(2+pid*2)) + SHM_BASE + id*SHM_SIZE;
+	mapPages(linear, linear, SHM_SIZE, PTE_W); // back to the process's private pages
+	pcb[pid].shmMask &= ~(1 << id);
+	shm[id].count--;
+	if (shm[id].count == 0)
+		shm[id].state = 0;
+}
+
+void syscallShm(struct StackFrame *sf) {
+	switch(sf->ecx) {
+		case SHM_CREATE:
+			syscallShmCreate(sf);
+			break;
+		case SHM_ATTACH:
+			syscallShmAttach(sf);
+			break;
+		case SHM_DETACH:
+			syscallShmDetach(sf);
+			break;
+		default:
+			pcb[current].regs.eax = -1;
+			break;
+	}
+}
+
+void syscallShmCreate(struct StackFrame *sf) {
+	uint32_t size = sf->edx;
+	uint32_t j;
+	int i;
+	if (size == 0 || size > SHM_SIZE) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	for (i = 0; i < MAX_SHM_NUM; i++) {
+		if (shm[i].state == 0)
+			break;
+	}
+	if (i == MAX_SHM_NUM) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	shm[i].state = 1;
+	shm[i].size = size;
+	shm[i].count = 0;
+	shm[i].creator = current;
+	for (j = 0; j < SHM_SIZE; j += 4)
+		*(uint32_t *)(SHM_PHYS + i*SHM_SIZE + j) = 0;
+	pcb[current].regs.eax = i;
+}
+
+void syscallShmAttach(struct StackFrame *sf) {
+	int id = (int)sf->edx;
+	if (id < 0 || id >= MAX_SHM_NUM || shm[id].state == 0) {
+		pcb[current].regs.eax = 0; // offset 0 is never a shm address
+		return;
+	}
+	if ((pcb[current].shmMask & (1 << id)) == 0)
+		shmMap(current, id);
+	pcb[current].regs.eax = SHM_BASE + id*SHM_SIZE;
+}
+
+void syscallShmDetach(struct StackFrame *sf) {
+	int id = (int)sf->edx;
+	if (id < 0 || id >= MAX_SHM_NUM || (pcb[current].shmMask & (1 << id)) == 0) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	shmUnmap(current, id);
+	pcb[current].regs.eax = 0;
+}
+
+/*
+ * semop: apply a set of waits/posts on sem[] all-or-nothing. If any decrement
+ * can not be satisfied nothing is applied and the caller sleeps on opWait of
+ * that semaphore. Every post that leaves a semaphore positive wakes all its
+ * opWait sleepers, which re-evaluate the whole set from the top.
+ */
+#define MAX_SEMOP_NUM MAX_SEM_NUM
+
+static void semWakeOps(int i) {
+	wakeAll(&(sem[i].opWait));
+	pollWake(&(sem[i].poll));
+}
+
+static int semOpBlocking(SemOp *ops, int n) {
+	int i, j, value;
+	for (i = 0; i < n; i++) {
+		if (ops[i].op >= 0)
+			continue;
+		value = sem[ops[i].sem].value;
+		for (j = 0; j < n; j++) {
+			if (ops[j].sem == ops[i].sem)
+				value += ops[j].op;
+		}
+		if (value < 0)
+			return ops[i].sem;
+	}
+	return -1;
+}
+
+void syscallSemOp(struct StackFrame *sf) {
+ disableInterrupt();
+	SemOp ops[MAX_SEMOP_NUM];
+	SemOp *user = NULL;
+	ProcessTable *pt = NULL;
+	int n = (int)sf->ebx;
+	int i, k, blocking;
+	uint32_t start = tickCount;
+	if (n > 0 && n <= MAX_SEMOP_NUM)
+		user = (SemOp*)userAddr(sf->ds, sf->edx, n*sizeof(SemOp));
+	if (user == NULL) {
+		pcb[current].regs.eax = -1;
+		enableInterrupt();
+		return;
+	}
+	for (i = 0; i < n; i++)
+		ops[i] = user[i];
+	while (1) {
+		for (i = 0; i < n; i++) {
+			if (ops[i].sem < 0 || ops[i].sem >= MAX_SEM_NUM || sem[ops[i].sem].state == 0)
+				break;
+		}
+		if (i != n) {
+			pcb[current].regs.eax = -1;
+			break;
+		}
+		blocking = semOpBlocking(ops, n);
+		if (blocking == -1) {
+			// posts first: a set that names a semaphore twice then never takes
+			// it below 0 midway, so a post only wakes waiters that really exist
+			for (i = 0; i < n; i++) {
+				if (ops[i].op < 0)
+					continue;
+				sem[ops[i].sem].stat.posts += ops[i].op;
+				for (k = 0; k < ops[i].op; k++) {//逐个V，和sem_post一样唤醒sem_wait里的进程
+					sem[ops[i].sem].value++;
+					if (sem[ops[i].sem].value <= 0) {
+						pt = (ProcessTable*)((uint32_t)(sem[ops[i].sem].pcb.prev) - (uint32_t)&(((ProcessTable*)0)->blocked));
+						sem[ops[i].sem].pcb.prev = (sem[ops[i].sem].pcb.prev)->prev;
+						(sem[ops[i].sem].pcb.prev)->next = &(sem[ops[i].sem].pcb);
+						pt->state = STATE_RUNNABLE;
+						pt->waitSem = -1;
+					}
+				}
+				if (sem[ops[i].sem].value > 0)
+					semWakeOps(ops[i].sem);
+			}
+			for (i = 0; i < n; i++) {
+				if (ops[i].op < 0) {
+					sem[ops[i].sem].value += ops[i].op;
+					semStatWait(ops[i].sem, start);
+				}
+			}
+			pcb[current].regs.eax = 0;
+			break;
+		}
+		pcb[current].state = STATE_BLOCKED;
+		pcb[current].sleepTime = 0x7fffffff;
+		pcb[current].blocked.next = sem[blocking].opWait.next;
+		pcb[current].blocked.prev = &(sem[blocking].opWait);
+		sem[blocking].opWait.next = &(pcb[current].blocked);
+		(pcb[current].blocked.next)->prev = &(pcb[current].blocked);
+		semStatBlock(blocking);
+		asm volatile("int $0x81");
+	}
+enableInterrupt();
+	return;
+}
+
+/*
+ * sem_timedwait: the caller sits on both the semaphore's pcb list and the
+ * sleep timer (sleepTime). A post that comes first takes it off the list and
+ * clears waitSem, so the timer ignores it; a timer that fires first takes it
+ * off the list in semTimeout() and gives the unit back. sem_destroy wakes
+ * every waiter with -1 and clears its waitSem as well.
+ * Returns 0 when acquired, SEM_TIMEOUT when timed out, -1 on a bad semaphore.
+ */
+static void semTimeout(int i) {
+	int index = pcb[i].waitSem;
+	pcb[i].waitSem = -1;
+	if (sem[index].state == 0) { // destroyed meanwhile, its list was reset
+		pcb[i].regs.eax = -1;
+		return;
+	}
+	(pcb[i].blocked.prev)->next = pcb[i].blocked.next;
+	(pcb[i].blocked.next)->prev = pcb[i].blocked.prev;
+	sem[index].value++;
+	pcb[i].regs.eax = SEM_TIMEOUT;
+}
+
+void syscallSemTimedWait(struct StackFrame *sf) {
+ disableInterrupt();
+	int index = (int)(sf->edx);
+	int ticks = (int)(sf->ebx);
+	uint32_t start = tickCount;
+	if (index < 0 || index >= MAX_SEM_NUM || sem[index].state == 0)
+		pcb[current].regs.eax = -1;
+	else {
+		sem[index].value--;
+		pcb[current].regs.eax = 0;
+		if (sem[index].value < 0) {
+			if (ticks <= 0) { // nothing to wait for, behave as a trywait
+				sem[index].value++;
+				pcb[current].regs.eax = SEM_TIMEOUT;
+			}
+			else {
+				pcb[current].state = STATE_BLOCKED;
+				pcb[current].sleepTime = ticks;
+				pcb[current].waitSem = index;
+				pcb[current].blocked.next = sem[index].pcb.next;
+				pcb[current].blocked.prev = &(sem[index].pcb);
+				sem[index].pcb.next = &(pcb[current].blocked);
+				(pcb[current].blocked.next)->prev = &(pcb[current].blocked);
+				semStatBlock(index);
+				asm volatile("int $0x81");
+			}
+		}
+		semStatWait(index, start);
+	}
+enableInterrupt();
+	return;
+}
+
+/* takes a unit only if that needs no waiting: 0 acquired, SEM_TIMEOUT not */
+void syscallSemTryWait(struct StackFrame *sf) {
+ disableInterrupt();
+	int index = (int)(sf->edx);
+	if (index < 0 || index >= MAX_SEM_NUM || sem[index].state == 0)
+		pcb[current].regs.eax = -1;
+	else if (sem[index].value <= 0)
+		pcb[current].regs.eax = SEM_TIMEOUT;
+	else {
+		sem[index].value--;
+		pcb[current].regs.eax = 0;
+		semStatWait(index, tickCount);
+	}
+enableInterrupt();
+	return;
+}
+
+/*
+ * Contention profile of sem[i]: semStatBlock() is called by a waiter right
+ * before it blocks, semStatWait() once its wait is over (acquired, timed out
+ * or the semaphore was destroyed) with the tickCount read on entry.
+ * SEM_STAT copies sem[edx].stat to the user pointer in ebx.
+ */
+static void semStatBlock(int i) {
+	struct ListHead *p = NULL;
+	uint32_t queue = 0;
+	for (p = sem[i].pcb.next; p != &(sem[i].pcb); p = p->next)
+		queue++;
+	for (p = sem[i].opWait.next; p != &(sem[i].opWait); p = p->next)
+		queue++;
+	sem[i].stat.contended++;
+	if (queue > sem[i].stat.maxQueue)
+		sem[i].stat.maxQueue = queue;
+}
+
+static void semStatWait(int i, uint32_t start) {
+	uint32_t ticks = tickCount - start;
+	int bucket = 0;
+	sem[i].stat.waits++;
+	sem[i].stat.blockedTicks += ticks;
+	while (ticks != 0 && bucket < SEM_HIST_NUM - 1) {
+		ticks >>= 1;
+		bucket++;
+	}
+	sem[i].stat.hist[bucket]++;
+}
+
+void syscallSemStat(struct StackFrame *sf) {
+	int index = (int)(sf->edx);
+	SemStat *user = (SemStat*)userAddr(sf->ds, sf->ebx, sizeof(SemStat));
+	if (index < 0 || index >= MAX_SEM_NUM || user == NULL) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	*user = sem[index].stat;
+	pcb[current].regs.eax = sem[index].state;
+}
+
+/* block the current process on queue until wakeAll(queue), the caller must
+ * raise int $0x81 to give up the CPU and re-check its condition */
+static void sleepOn(struct ListHead *queue) {
+	pcb[current].state = STATE_BLOCKED;
+	pcb[current].sleepTime = -1;
+	pcb[current].blocked.next = queue->next;
+	pcb[current].blocked.prev = queue;
+	queue->next = &(pcb[current].blocked);
+	(pcb[current].blocked.next)->prev = &(pcb[current].blocked);
+}
+
+static void wakeAll(struct ListHead *queue) {
+	ProcessTable *pt = NULL;
+	while (queue->next != queue) {
+		pt = (ProcessTable*)((uint32_t)(queue->next) - (uint32_t)&(((ProcessTable*)0)->blocked));
+		queue->next = (queue->next)->next;
+		(queue->next)->prev = queue;
+		pt->state = STATE_RUNNABLE;
+	}
+}
+
+/*
+ * Pipes: a kernel ring buffer of PIPE_SIZE bytes. A read returns whatever is
+ * buffered (up to size) in one go and only blocks on an empty pipe, returning
+ * 0 once every write end is closed. A write copies as much as fits per pass
+ * and blocks on a full pipe until all of it is in, -1 if nobody can read it.
+ */
+static int pipeEnd(int fd, int end) {
+	int entry;
+	if (fd < FD_FIRST || fd >= MAX_FD_NUM)
+		return -1;
+	entry = pcb[current].fd[fd];
+	if (entry == -1 || entry % 2 != end)
+		return -1;
+	return entry / 2;
+}
+
+static void pipeClose(int pid, int fd) {
+	int index = pcb[pid].fd[fd] / 2;
+	if (pcb[pid].fd[fd] % 2 == PIPE_READ) {
+		pipe[index].readers--;
+		wakeAll(&(pipe[index].writeWait)); // writers find out nobody reads
+	}
+	else {
+		pipe[index].writers--;
+		wakeAll(&(pipe[index].readWait)); // readers find out about EOF
+	}
+	pollWake(&(pipe[index].poll));
+	pcb[pid].fd[fd] = -1;
+	if (pipe[index].readers == 0 && pipe[index].writers == 0)
+		pipe[index].state = 0;
+}
+
+void syscallPipe(struct StackFrame *sf) {
+	int *fds = (int*)userAddr(sf->ds, sf->ecx, 2*sizeof(int));
+	int i, rfd, wfd;
+	pcb[current].regs.eax = -1;
+	if (fds == NULL)
+		return;
+	for (i = 0; i < MAX_PIPE_NUM; i++) {
+		if (pipe[i].state == 0)
+			break;
+	}
+	for (rfd = FD_FIRST; rfd < MAX_FD_NUM && pcb[current].fd[rfd] != -1; rfd++);
+	for (wfd = rfd+1; wfd < MAX_FD_NUM && pcb[current].fd[wfd] != -1; wfd++);
+	if (i == MAX_PIPE_NUM || wfd >= MAX_FD_NUM)
+		return;
+	pipe[i].state = 1;
+	pipe[i].head = 0;
+	pipe[i].count = 0;
+	pipe[i].readers = 1;
+	pipe[i].writers = 1;
+	pcb[current].fd[rfd] = i*2 + PIPE_READ;
+	pcb[current].fd[wfd] = i*2 + PIPE_WRITE;
+	fds[0] = rfd;
+	fds[1] = wfd;
+	pcb[current].regs.eax = 0;
+}
+
+void syscallClose(struct StackFrame *sf) {
+	int fd = (int)sf->ecx;
+	if (fd < FD_FIRST || fd >= MAX_FD_NUM || pcb[current].fd[fd] == -1) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	pipeClose(current, fd);
+	pcb[current].regs.eax = 0;
+}
+
+void syscallReadPipe(struct StackFrame *sf) {
+ disableInterrupt();
+	int index = pipeEnd(sf->ecx, PIPE_READ);
+	int size = (int)sf->ebx;
+	uint8_t *str = (uint8_t*)userAddr(sf->ds, sf->edx, size);
+	Pipe *p = NULL;
+	int i, n;
+	if (index == -1 || str == NULL || size < 0) {
+		pcb[current].regs.eax = -1;
+		enableInterrupt();
+		return;
+	}
+	p = &pipe[index];
+	while (p->count == 0 && p->writers != 0 && size != 0) {
+		sleepOn(&(p->readWait));
+		asm volatile("int $0x81");
+	}
+	n = p->count < size ? p->count : size;
+	i = n < PIPE_SIZE - p->head ? n : PIPE_SIZE - p->head; // up to the end of the ring
+	memcpy(str, p->buffer + p->head, i);
+	memcpy(str + i, p->buffer, n - i);
+	p->head = (p->head + n) % PIPE_SIZE;
+	p->count -= n;
+	if (n != 0) {
+		wakeAll(&(p->writeWait));
+		pollWake(&(p->poll));
+	}
+	pcb[current].regs.eax = n;
+enableInterrupt();
+	return;
+}
+
+void syscallWritePipe(struct StackFrame *sf) {
+ disableInterrupt();
+	int index = pipeEnd(sf->ecx, PIPE_WRITE);
+	int size = (int)sf->ebx;
+	uint8_t *str = (uint8_t*)userAddr(sf->ds, sf->edx, size);
+	Pipe *p = NULL;
+	int i, n, tail;
+	int total = 0;
+	if (index == -1 || str == NULL || size < 0) {
+		pcb[current].regs.eax = -1;
+		enableInterrupt();
+		return;
+	}
+	p = &pipe[index];
+	while (total < size && p->readers != 0) {
+		if (p->count == PIPE_SIZE) {
+			sleepOn(&(p->writeWait));
+			asm volatile("int $0x81");
+			continue;
+		}
+		n = PIPE_SIZE - p->count;
+		if (n > size - total)
+			n = size - total;
+		tail = (p->head + p->count) % PIPE_SIZE;
+		i = n < PIPE_SIZE - tail ? n : PIPE_SIZE - tail;
+		memcpy(p->buffer + tail, str + total, i);
+		memcpy(p->buffer, str + total + i, n - i);
+		p->count += n;
+		total += n;
+		wakeAll(&(p->readWait));
+		pollWake(&(p->poll));
+	}
+	pcb[current].regs.eax = (total == 0 && size != 0) ? -1 : total;
+enableInterrupt();
+	return;
+}
+
+/*
+ * Synchronous IPC: a message is the three registers ebx, esi, edi. ipc_call
+ * hands it to a server sitting in ipc_reply_wait and switches straight to the
+ * server (giving it the rest of the caller's quantum); ipc_reply_wait writes
+ * the reply into the client's saved registers and switches straight back when
+ * no other call is queued. Neither direction goes through the scheduler.
+ * A call to a busy server queues on its ipcSenders list.
+ */
+static void ipcDeliver(int from, int to) {
+	pcb[to].regs.eax = from;
+	pcb[to].regs.ebx = pcb[from].regs.ebx;
+	pcb[to].regs.esi = pcb[from].regs.esi;
+	pcb[to].regs.edi = pcb[from].regs.edi;
+	pcb[from].ipcState = IPC_REPLY;
+}
+
+/* fail every call waiting on the dying process pid */
+static void ipcAbort(int pid) {
+	ProcessTable *pt = NULL;
+	int i;
+	while (pcb[pid].ipcSenders.next != &(pcb[pid].ipcSenders)) {
+		pt = (ProcessTable*)((uint32_t)(pcb[pid].ipcSenders.next) - (uint32_t)&(((ProcessTable*)0)->blocked));
+		pcb[pid].ipcSenders.next = (pcb[pid].ipcSenders.next)->next;
+		(pcb[pid].ipcSenders.next)->prev = &(pcb[pid].ipcSenders);
+		pt->ipcState = IPC_NONE;
+		pt->regs.eax = -1;
+		pt->state = STATE_RUNNABLE;
+	}
+	for (i = 0; i < MAX_PCB_NUM; i++) {
+		if (pcb[i].ipcState == IPC_REPLY && pcb[i].ipcPartner == pid) {
+			pcb[i].ipcState = IPC_NONE;
+			pcb[i].regs.eax = -1;
+			pcb[i].state = STATE_RUNNABLE;
+		}
+	}
+	pcb[pid].ipcState = IPC_NONE;
+}
+
+void syscallIpc(struct StackFrame *sf) {
+	switch(sf->ecx) {
+		case IPC_CALL:
+			syscallIpcCall(sf);
+			break;
+		case IPC_REPLY_WAIT:
+			syscallIpcReplyWait(sf);
+			break;
+		default:
+			pcb[current].regs.eax = -1;
+			break;
+	}
+}
+
+void syscallIpcCall(struct StackFrame *sf) {
+	int dst = (int)sf->edx;
+	if (dst <= 0 || dst >= MAX_PCB_NUM || dst == current || pcb[dst].state == STATE_DEAD) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	pcb[current].ipcPartner = dst;
+	pcb[current].state = STATE_BLOCKED;
+	pcb[current].sleepTime = -1;
+	if (pcb[dst].ipcState == IPC_RECV) {
+		ipcDeliver(current, dst);
+		pcb[dst].ipcState = IPC_NONE;
+		pcb[dst].timeCount = pcb[current].timeCount;
+		switchProc(dst);
+	}
+	pcb[current].ipcState = IPC_SEND;
+	pcb[current].blocked.next = pcb[dst].ipcSenders.next;
+	pcb[current].blocked.prev = &(pcb[dst].ipcSenders);
+	pcb[dst].ipcSenders.next = &(pcb[current].blocked);
+	(pcb[current].blocked.next)->prev = &(pcb[current].blocked);
+	asm volatile("int $0x81"); // the reply lands in pcb[current].regs
+}
+
+void syscallIpcReplyWait(struct StackFrame *sf) {
+	int client = (int)sf->edx;
+	ProcessTable *pt = NULL;
+	if (client != -1) {
+		if (client <= 0 || client >= MAX_PCB_NUM || pcb[client].ipcState != IPC_REPLY ||
+			pcb[client].ipcPartner != current) {
+			pcb[current].regs.eax = -1;
+			return;
+		}
+		pcb[client].regs.eax = 0;
+		pcb[client].regs.ebx = sf->ebx;
+		pcb[client].regs.esi = sf->esi;
+		pcb[client].regs.edi = sf->edi;
+		pcb[client].ipcState = IPC_NONE;
+		pcb[client].state = STATE_RUNNABLE;
+	}
+	if (pcb[current].ipcSenders.prev != &(pcb[current].ipcSenders)) { // oldest queued call
+		pt = (ProcessTable*)((uint32_t)(pcb[current].ipcSenders.prev) - (uint32_t)&(((ProcessTable*)0)->blocked));
+		pcb[current].ipcSenders.prev = (pcb[current].ipcSenders.prev)->prev;
+		(pcb[current].ipcSenders.prev)->next = &(pcb[current].ipcSenders);
+		ipcDeliver(pt->pid, current);
+		return;
+	}
+	pcb[current].ipcState = IPC_RECV;
+	pcb[current].state = STATE_BLOCKED;
+	pcb[current].sleepTime = -1;
+	if (client != -1) {
+		pcb[client].timeCount = pcb[current].timeCount;
+		switchProc(client);
+	}
+	asm volatile("int $0x81"); // the next call lands in pcb[current].regs
+}
+
+/*
+ * poll: waits for the first of up to MAX_POLL_NUM events. Instead of the one
+ * blocked link a process has, each entry links its own PollWait into the poll
+ * list of the device, semaphore or pipe it watches. Whoever changes the state
+ * of one of those calls pollWake(), the poller unlinks all its entries and
+ * checks them again. Nothing is consumed: a semaphore reported POLLIN still
+ * has to be taken with sem_wait/sem_timedwait.
+ * timeout<0 waits forever, 0 only checks, >0 waits at most that many ticks.
+ * Returns the number of entries with revents set, 0 on timeout, -1 on error.
+ */
+static int pollCheck(PollFd *p, struct ListHead **queue) {
+	int ready = 0;
+	int entry;
+	*queue = NULL;
+	if (p->events & POLLSEM) {
+		if (p->fd < 0 || p->fd >= MAX_SEM_NUM || sem[p->fd].state == 0)
+			return POLLNVAL;
+		*queue = &(sem[p->fd].poll);
+		if (sem[p->fd].value > 0)
+			ready = POLLIN;
+	}
+	else if (p->fd == STD_IN) {
+		*queue = &(dev[STD_IN].poll);
+		if (dev[STD_IN].value > 0)
+			ready = POLLIN;
+	}
+	else if (p->fd == STD_OUT)
+		ready = POLLOUT;
+	else {
+		if (p->fd < FD_FIRST || p->fd >= MAX_FD_NUM || pcb[current].fd[p->fd] == -1)
+			return POLLNVAL;
+		entry = pcb[current].fd[p->fd];
+		*queue = &(pipe[entry/2].poll);
+		if (entry % 2 == PIPE_READ) {
+			if (pipe[entry/2].count != 0)
+				ready = POLLIN;
+			if (pipe[entry/2].writers == 0)
+				ready |= POLLHUP;
+		}
+		else {
+			if (pipe[entry/2].count != PIPE_SIZE)
+				ready = POLLOUT;
+			if (pipe[entry/2].readers == 0)
+				ready |= POLLHUP;
+		}
+	}
+	return ready & (p->events | POLLHUP);
+}
+
+static void pollWake(struct ListHead *queue) {
+	struct ListHead *p = NULL;
+	ProcessTable *pt = NULL;
+	for (p = queue->next; p != queue; p = p->next) {
+		pt = &pcb[((struct PollWait*)p)->pid];
+		if (pt->state == STATE_BLOCKED)
+			pt->state = STATE_RUNNABLE;
+	}
+}
+
+void syscallPoll(struct StackFrame *sf) {
+ disableInterrupt();
+	int n = (int)sf->edx;
+	int timeout = (int)sf->ebx;
+	uint32_t deadline = tickCount + timeout;
+	PollFd *fds = NULL;
+	struct ListHead *queue[MAX_POLL_NUM];
+	struct PollWait *w = NULL;
+	int i, ready;
+	if (n > 0 && n <= MAX_POLL_NUM)
+		fds = (PollFd*)userAddr(sf->ds, sf->ecx, n*sizeof(PollFd));
+	if (n < 0 || n > MAX_POLL_NUM || (n > 0 && fds == NULL)) {
+		pcb[current].regs.eax = -1;
+		enableInterrupt();
+		return;
+	}
+	while (1) {
+		ready = 0;
+		for (i = 0; i < n; i++) {
+			fds[i].revents = pollCheck(&fds[i], &queue[i]);
+			if (fds[i].revents != 0)
+				ready++;
+		}
+		if (ready != 0 || timeout == 0 || (timeout > 0 && (int)(deadline - tickCount) <= 0))
+			break;
+		for (i = 0; i < n; i++) {
+			w = &(pcb[current].pollWait[i]);
+			w->pid = current;
+			w->link.next = w->link.prev = &(w->link);
+			if (queue[i] == NULL) // stdout without POLLOUT, never ready
+				continue;
+			w->link.next = queue[i]->next;
+			w->link.prev = queue[i];
+			queue[i]->next = &(w->link);
+			(w->link.next)->prev = &(w->link);
+		}
+		pcb[current].state = STATE_BLOCKED;
+		pcb[current].sleepTime = timeout < 0 ? -1 : (int)(deadline - tickCount);
+		asm volatile("int $0x81");
+		for (i = 0; i < n; i++) {
+			w = &(pcb[current].pollWait[i]);
+			(w->link.prev)->next = w->link.next;
+			(w->link.next)->prev = w->link.prev;
+		}
+	}
+	pcb[current].regs.eax = ready;
+enableInterrupt();
+	return;
+}
+
+/*
+ * Batched system calls: the process queues RingSqe entries in a Ring in its
+ * own memory, registered once with RING_SETUP, and one RING_ENTER runs them
+ * in order. Each goes through syscallHandle() with a StackFrame made up as
+ * if it had trapped by itself, so it behaves (and may block) exactly like
+ * the plain call; its result is posted as a RingCqe. Entering stops when sq
+ * is empty or cq is full, and returns how many entries ran.
+ */
+void syscallRing(struct StackFrame *sf) {
+	switch(sf->ecx) {
+		case RING_SETUP:
+			syscallRingSetup(sf);
+			break;
+		case RING_ENTER:
+			syscallRingEnter(sf);
+			break;
+		default:
+			pcb[current].regs.eax = -1;
+			break;
+	}
+}
+
+void syscallRingSetup(struct StackFrame *sf) {
+	Ring *r = (Ring*)userAddr(sf->ds, sf->edx, sizeof(Ring));
+	if (sf->edx == 0 || r == NULL) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	r->sqHead = r->sqTail = 0;
+	r->cqHead = r->cqTail = 0;
+	pcb[current].ring = sf->edx;
+	pcb[current].regs.eax = 0;
+}
+
+void syscallRingEnter(struct StackFrame *sf) {
+	Ring *r = NULL;
+	RingSqe sqe;
+	struct StackFrame f;
+	int n = 0;
+	if (pcb[current].ring != 0)
+		r = (Ring*)userAddr(sf->ds, pcb[current].ring, sizeof(Ring));
+	if (r == NULL) {
+		pcb[current].regs.eax = -1;
+		return;
+	}
+	while (r->sqHead != r->sqTail && r->cqTail - r->cqHead < RING_SIZE) {
+		sqe = r->sq[r->sqHead % RING_SIZE];
+		r->sqHead++;
+		f = *sf;
+		f.ecx = sqe.a1;
+		f.edx = sqe.a2;
+		f.ebx = sqe.a3;
+		switch(sqe.op) {
+			case RING_WRITE:
+				f.eax = SYS_WRITE;
+				break;
+			case RING_SEM_POST:
+				f.eax = SYS_SEM;
+				f.ecx = SEM_POST;
+				f.edx = sqe.a1;
+				f.ebx = SEM_WAKE;
+				break;
+			case RING_SEM_TRYWAIT:
+				f.eax = SYS_SEM;
+				f.ecx = SEM_TRYWAIT;
+				f.edx = sqe.a1;
+				break;
+			case RING_SLEEP:
+				f.eax = SYS_SLEEP;
+				break;
+			default:
+				f.eax = -1;
+				break;
+		}
+		pcb[current].regs.eax = f.eax == -1 ? -1 : 0; // for handlers that report nothing
+		if (f.eax != -1) {
+			disableInterrupt(); // as on a trap
+			syscallHandle(&f);
+		}
+		r->cq[r->cqTail % RING_SIZE].res = pcb[current].regs.eax;
+		r->cq[r->cqTail % RING_SIZE].data = sqe.data;
+		r->cqTail++;
+		n++;
+	}
+	pcb[current].regs.eax = n;
+}
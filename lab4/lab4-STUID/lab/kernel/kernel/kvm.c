@@ -5,10 +5,16 @@ SegDesc
     gdt[NR_SEGMENTS];  // the new GDT, NR_SEGMENTS=10, defined in x86/memory.h
 TSS tss;
 
+uint32_t pageDir[PG_SIZE / 4] __attribute__((aligned(PG_SIZE)));
+uint32_t pageTable[NR_PAGETABLE][PG_SIZE / 4] __attribute__((aligned(PG_SIZE)));
+
 ProcessTable pcb[MAX_PCB_NUM];  // pcb
 int current;                    // current process
 
 Semaphore sem[MAX_SEM_NUM];
+Futex futex[MAX_FUTEX_NUM];
+Shm shm[MAX_SHM_NUM];
+Pipe pipe[MAX_PIPE_NUM];
 Device dev[MAX_DEV_NUM];
 
 /*
@@ -49,19 +55,117 @@ void initSeg() {  // setup kernel segements
 
     /* reassign segment register */
     asm volatile("movw %%ax,%%ds" ::"a"(KSEL(SEG_KDATA)));
+    asm volatile("movw %%ax,%%es" ::"a"(KSEL(SEG_KDATA)));
     asm volatile("movw %%ax,%%ss" ::"a"(KSEL(SEG_KDATA)));
 
     lLdt(0);
 }
 
+void sysenterEntry(void);
+
+static uint32_t sysenterStack[16];
+
+/* sysenter starts on sysenterStack only until sysenterEntry's first
+ * instruction loads tss.esp0, which changes with every process switch */
+void initSysenter() {
+    if (!(cpuidFeatures() & CPUID_SEP)) return;  // int $0x80 only
+    writeMsr(MSR_SYSENTER_CS, KSEL(SEG_KCODE));  // ss is the next entry
+    writeMsr(MSR_SYSENTER_ESP, (uint32_t)&sysenterStack[16]);
+    writeMsr(MSR_SYSENTER_EIP, (uint32_t)sysenterEntry);
+}
+
+/*
+Paging only exists so that a shared memory segment can show up inside several
+user segments: the low 16MB is identity mapped, so linear==physical everywhere
+except for the shm windows and vdso pages remapped by mapPages().
+*/
+void initPage() {
+    int i, j;
+    for (i = 0; i < PG_SIZE / 4; i++) pageDir[i] = 0;
+    for (i = 0; i < NR_PAGETABLE; i++) {
+        for (j = 0; j < PG_SIZE / 4; j++)
+            pageTable[i][j] =
+                ((i * (PG_SIZE / 4) + j) * PG_SIZE) | PTE_P | PTE_W | PTE_U;
+        pageDir[i] = (uint32_t)pageTable[i] | PTE_P | PTE_W | PTE_U;
+    }
+    setCr3((uint32_t)pageDir);
+    enablePaging();
+}
+
+/* perm: PTE_W, or 0 for pages user mode may only read (the kernel still
+ * writes them, CR0.WP is off) */
+void mapPages(uint32_t linear, uint32_t phys, uint32_t size, uint32_t perm) {
+    uint32_t i;
+    for (i = 0; i < size; i += PG_SIZE)
+        pageTable[(linear + i) >> 22][((linear + i) >> 12) & 0x3ff] =
+            ((phys + i) & ~(PG_SIZE - 1)) | PTE_P | PTE_U | perm;
+    flushTlb();
+}
+
+uint32_t linearToPhys(uint32_t linear) {
+    if ((linear >> 22) >= NR_PAGETABLE) return linear;
+    return (pageTable[linear >> 22][(linear >> 12) & 0x3ff] & ~(PG_SIZE - 1)) |
+           (linear & (PG_SIZE - 1));
+}
+
 void initSem() {
-    int i;
+    int i, j;
     for (i = 0; i < MAX_SEM_NUM; i++) {
         sem[i].state = 0;  // 0: not in use; 1: in use;
         sem[i].value = 0;  // >=0: no process blocked; -1: 1 process blocked;
                            // -2: 2 process blocked;...
         sem[i].pcb.next = &(sem[i].pcb);
         sem[i].pcb.prev = &(sem[i].pcb);
+        sem[i].opWait.next = &(sem[i].opWait);
+        sem[i].opWait.prev = &(sem[i].opWait);
+        sem[i].poll.next = &(sem[i].poll);
+        sem[i].poll.prev = &(sem[i].poll);
+        sem[i].stat.waits = 0;
+        sem[i].stat.contended = 0;
+        sem[i].stat.posts = 0;
+        sem[i].stat.maxQueue = 0;
+        sem[i].stat.blockedTicks = 0;
+        for (j = 0; j < SEM_HIST_NUM; j++)
+            sem[i].stat.hist[j] = 0;
+    }
+}
+
+void initFutex() {
+    int i;
+    for (i = 0; i < MAX_FUTEX_NUM; i++) {
+        futex[i].state = 0;  // 0: not in use; 1: in use;
+        futex[i].key = 0;
+        futex[i].value = 0;  // >0: wakeups posted before anyone waited;
+                             // <0: -value processes blocked;
+        futex[i].pcb.next = &(futex[i].pcb);
+        futex[i].pcb.prev = &(futex[i].pcb);
+    }
+}
+
+void initShm() {
+    int i;
+    for (i = 0; i < MAX_SHM_NUM; i++) {
+        shm[i].state = 0;  // 0: not in use; 1: in use;
+        shm[i].size = 0;
+        shm[i].count = 0;
+        shm[i].creator = -1;
+    }
+}
+
+void initPipe() {
+    int i;
+    for (i = 0; i < MAX_PIPE_NUM; i++) {
+        pipe[i].state = 0;  // 0: not in use; 1: in use;
+        pipe[i].head = 0;
+        pipe[i].count = 0;
+        pipe[i].readers = 0;
+        pipe[i].writers = 0;
+        pipe[i].readWait.next = &(pipe[i].readWait);
+        pipe[i].readWait.prev = &(pipe[i].readWait);
+        pipe[i].writeWait.next = &(pipe[i].writeWait);
+        pipe[i].writeWait.prev = &(pipe[i].writeWait);
+        pipe[i].poll.next = &(pipe[i].poll);
+        pipe[i].poll.prev = &(pipe[i].poll);
     }
 }
 
@@ -73,15 +177,41 @@ void initDev() {
                            // process blocked;...
         dev[i].pcb.next = &(dev[i].pcb);
         dev[i].pcb.prev = &(dev[i].pcb);
+        dev[i].poll.next = &(dev[i].poll);
+        dev[i].poll.prev = &(dev[i].poll);
     }
 }
 
+/* base address of the segment selected by sel, i.e., offset 0 of a user
+ * process in the linear address space */
+uint32_t segBase(uint32_t sel) {
+    SegDesc *desc = &gdt[sel >> 3];
+    return desc->base_15_0 | (desc->base_23_16 << 16) |
+           (desc->base_31_24 << 24);
+}
+
+/* kernel pointer to [addr, addr+size) of the user segment selected by sel,
+ * NULL if the range is outside the 1MB segment */
+void *userAddr(uint32_t sel, uint32_t addr, uint32_t size) {
+    if (addr > 0x100000 || size > 0x100000 - addr) return NULL;
+    return (void *)(segBase(sel) + addr);
+}
+
 uint32_t loadUMain(void);
 
+uint32_t uMainEnd;  // end of the user image with its .bss, where heaps start
+
 void initProc() {
-    int i;
+    int i, j;
     for (i = 0; i < MAX_PCB_NUM; i++) {
         pcb[i].state = STATE_DEAD;
+        pcb[i].shmMask = 0;
+        pcb[i].waitSem = -1;
+        pcb[i].ring = 0;
+        for (j = 0; j < MAX_FD_NUM; j++) pcb[i].fd[j] = -1;
+        pcb[i].ipcState = IPC_NONE;
+        pcb[i].ipcSenders.next = &(pcb[i].ipcSenders);
+        pcb[i].ipcSenders.prev = &(pcb[i].ipcSenders);
     }
     // kernel process
     pcb[0].stackTop = (uint32_t) & (pcb[0].stackTop);
@@ -105,6 +235,8 @@ void initProc() {
     pcb[1].regs.eflags = pcb[1].regs.eflags | 0x200;
     pcb[1].regs.cs = USEL(3);
     pcb[1].regs.eip = loadUMain();
+    pcb[1].brk = uMainEnd;
+    vdsoStart(1);
     pcb[1].regs.ds = USEL(4);
     pcb[1].regs.es = USEL(4);
     pcb[1].regs.fs = USEL(4);
@@ -125,12 +257,17 @@ user program is loaded to location 0x200000, i.e., 2MB
 size of user program is not greater than 200*512 bytes, i.e., 100KB
 */
 
+#define MAX_PH_NUM 8
+
 uint32_t loadUMain(void) {
     int i = 0;
+    int j = 0;
     int phoff = 0x34;         // program header offset
     int offset = 0x1000;      // .text section offset
     uint32_t elf = 0x200000;  // physical memory addr to load
     uint32_t uMainEntry = 0x200000;
+    struct ProgramHeader ph[MAX_PH_NUM];
+    int phnum = 0;
 
     for (i = 0; i < 200; i++) {
         readSect((void *)(elf + i * 512), 201 + i);
@@ -140,9 +277,22 @@ uint32_t loadUMain(void) {
         ((struct ELFHeader *)elf)->entry;  // entry address of the program
     phoff = ((struct ELFHeader *)elf)->phoff;
     offset = ((struct ProgramHeader *)(elf + phoff))->off;
+    phnum = ((struct ELFHeader *)elf)->phnum;
+    if (phnum > MAX_PH_NUM) phnum = MAX_PH_NUM;
+    for (j = 0; j < phnum; j++)  // the copy below overwrites them
+        ph[j] = ((struct ProgramHeader *)(elf + phoff))[j];
+
+    memmove((void *)elf, (void *)(elf + offset), 200 * 512);
 
-    for (i = 0; i < 200 * 512; i++) {
-        *(uint8_t *)(elf + i) = *(uint8_t *)(elf + i + offset);
+    // .bss: whatever followed .data in the file is there now
+    uMainEnd = 0;
+    for (j = 0; j < phnum; j++) {
+        if (ph[j].type != 1)  // PT_LOAD
+            continue;
+        memset((void *)(elf + ph[j].vaddr + ph[j].filesz), 0,
+               ph[j].memsz - ph[j].filesz);
+        if (ph[j].vaddr + ph[j].memsz > uMainEnd)
+            uMainEnd = ph[j].vaddr + ph[j].memsz;
     }
 
     return uMainEntry;
@@ -3,6 +3,32 @@
 
 #define SERIAL_PORT  0x3F8
 
+/*
+ * Transmit goes through txRing: putChar only queues the byte, and the UART
+ * raises IRQ 4 whenever its 16-byte FIFO runs empty, upon which serialIntr
+ * refills it from the ring. serialFlush drains the ring by polling, for the
+ * paths that run with interrupts off for good (abort).
+ * Received bytes are moved by serialIntr into rxRing and handed on to the
+ * tty by the SOFTIRQ_SERIAL bottom half, which takes them with serialGetChar.
+ */
+#define SERIAL_TX_SIZE 1024
+#define SERIAL_RX_SIZE 256
+#define SERIAL_FIFO_SIZE 16
+#define IER_RX 0x1 // interrupt when received data is available
+#define IER_THRE 0x2 // interrupt when the transmit FIFO is empty
+#define IIR_NONE 0x1
+#define IIR_THRE 0x2
+#define IIR_RX 0x4
+#define IIR_TIMEOUT 0xc // bytes sat in the receive FIFO below its trigger level
+
+static char txRing[SERIAL_TX_SIZE];
+static volatile int txHead = 0;
+static volatile int txTail = 0;
+static char rxRing[SERIAL_RX_SIZE];
+static volatile int rxHead = 0;
+static volatile int rxTail = 0;
+static uint8_t serialIer = 0;
+
 void initSerial(void) {
 	outByte(SERIAL_PORT + 1, 0x00);
 	outByte(SERIAL_PORT + 3, 0x80);
@@ -11,14 +37,97 @@ void initSerial(void) {
 	outByte(SERIAL_PORT + 3, 0x03);
 	outByte(SERIAL_PORT + 2, 0xC7);
 	outByte(SERIAL_PORT + 4, 0x0B);
+	txHead = 0;
+	txTail = 0;
+	rxHead = 0;
+	rxTail = 0;
+	serialIer = IER_RX;
+	outByte(SERIAL_PORT + 1, serialIer);
 }
 
 static inline int serialIdle(void) {
 	return (inByte(SERIAL_PORT + 5) & 0x20) != 0;
 }
 
+/* interrupts off: refill an empty FIFO and ask for an interrupt while
+ * anything is left in the ring */
+static void serialStart(void) {
+	int i;
+	if (serialIdle() == TRUE) {
+		for (i = 0; i < SERIAL_FIFO_SIZE && txHead != txTail; i++) {
+			outByte(SERIAL_PORT, txRing[txHead]);
+			txHead = (txHead + 1) % SERIAL_TX_SIZE;
+		}
+	}
+	if (txHead != txTail)
+		serialIer |= IER_THRE;
+	else
+		serialIer &= ~IER_THRE;
+	outByte(SERIAL_PORT + 1, serialIer);
+}
+
+/* interrupts off */
+static void serialQueue(char ch) {
+	if ((txTail + 1) % SERIAL_TX_SIZE == txHead) { // ring full: make room the slow way
+		while (serialIdle() != TRUE);
+		outByte(SERIAL_PORT, txRing[txHead]);
+		txHead = (txHead + 1) % SERIAL_TX_SIZE;
+	}
+	txRing[txTail] = ch;
+	txTail = (txTail + 1) % SERIAL_TX_SIZE;
+}
+
 void putChar(char ch) {
-	while (serialIdle() != TRUE);
-	outByte(SERIAL_PORT, ch);
+	serialWrite(&ch, 1);
 }
 
+void serialWrite(const char *str, int size) {
+	uint32_t eflags;
+	int i;
+	asm volatile("pushfl; popl %0; cli":"=r"(eflags));
+	for (i = 0; i < size; i++)
+		serialQueue(str[i]);
+	serialStart();
+	if (eflags & 0x200)
+		enableInterrupt();
+}
+
+void serialIntr(void) {
+	uint8_t iir;
+	while (((iir = inByte(SERIAL_PORT + 2)) & 0x0f) != IIR_NONE) {
+		switch (iir & 0x0f) {
+			case IIR_THRE:
+				serialStart();
+				break;
+			case IIR_RX:
+			case IIR_TIMEOUT:
+				while (inByte(SERIAL_PORT + 5) & 0x1) {
+					rxRing[rxTail] = inByte(SERIAL_PORT);
+					if ((rxTail + 1) % SERIAL_RX_SIZE != rxHead) // full: drop the byte
+						rxTail = (rxTail + 1) % SERIAL_RX_SIZE;
+				}
+				raiseSoftirq(SOFTIRQ_SERIAL);
+				break;
+			default: // line or modem status, reading them clears the interrupt
+				inByte(SERIAL_PORT + 5);
+				inByte(SERIAL_PORT + 6);
+				break;
+		}
+	}
+}
+
+int serialGetChar(char *ch) {
+	if (rxHead == rxTail)
+		return 0;
+	*ch = rxRing[rxHead];
+	rxHead = (rxHead + 1) % SERIAL_RX_SIZE;
+	return 1;
+}
+
+void serialFlush(void) {
+	while (txHead != txTail) {
+		while (serialIdle() != TRUE);
+		outByte(SERIAL_PORT, txRing[txHead]);
+		txHead = (txHead + 1) % SERIAL_TX_SIZE;
+	}
+}
@@ -0,0 +1,46 @@
+#include "x86.h"
+
+/*
+ * Deferred work of interrupt handlers. A hard IRQ handler only grabs what the
+ * device has (with interrupts off) and raises a softirq; irqHandle runs the
+ * raised ones on its way out with interrupts on, so other IRQs are taken
+ * meanwhile. softirqActive keeps a nested IRQ from running them again and
+ * stops the timer from switching away in the middle of one.
+ */
+
+volatile int softirqActive = 0;
+static volatile uint32_t softirqPending = 0;
+
+static void (*softirqAction[NR_SOFTIRQ])(void) = {
+	keyboardSoftirq, // SOFTIRQ_KEYBOARD
+	serialSoftirq, // SOFTIRQ_SERIAL
+	printkSoftirq, // SOFTIRQ_PRINTK
+};
+
+/* called with interrupts off */
+void raiseSoftirq(int nr) {
+	softirqPending |= 1 << nr;
+}
+
+/* returns with interrupts off; system call handlers may have turned them
+ * on, so they go off first or a raise between the read and the clear of
+ * softirqPending would be lost */
+void doSoftirq(void) {
+	uint32_t pending;
+	int i;
+	disableInterrupt();
+	if (softirqActive)
+		return;
+	softirqActive = 1;
+	while (softirqPending != 0) {
+		pending = softirqPending;
+		softirqPending = 0;
+		enableInterrupt();
+		for (i = 0; i < NR_SOFTIRQ; i++) {
+			if (pending & (1 << i))
+				softirqAction[i]();
+		}
+		disableInterrupt();
+	}
+	softirqActive = 0;
+}
@@ -0,0 +1,82 @@
+#include "x86.h"
+#include "device.h"
+
+/*
+ * Canonical line discipline of the console. keyBuffer is a ring where
+ * [bufferHead, lineStart) holds finished lines waiting for readers and
+ * [lineStart, bufferTail) is the line still being typed, which backspace
+ * edits. Readers only ever see finished lines.
+ */
+
+extern uint32_t keyBuffer[MAX_KEYBUFFER_SIZE];
+extern int bufferHead;
+extern int bufferTail;
+
+extern int displayRow;
+extern int displayCol;
+
+static int lineStart;
+
+int consoleMode = CONSOLE_DEFAULT;
+
+void initTty() {
+	lineStart = bufferTail;
+}
+
+void consoleWrite(const char *str, int size) {
+	if (consoleMode & CONSOLE_VGA)
+		vgaWrite(str, size);
+	if (consoleMode & CONSOLE_SERIAL)
+		serialWrite(str, size);
+}
+
+static void ttyEcho(char c) {
+	uint16_t data = 0 | (0x0c << 8);
+	if (c != '\b') {
+		consoleWrite(&c, 1);
+		return;
+	}
+	if (consoleMode & CONSOLE_SERIAL)
+		serialWrite("\b \b", 3);
+	if ((consoleMode & CONSOLE_VGA) == 0 || (displayCol == 0 && displayRow == 0))
+		return;
+	if (displayCol == 0) { // the line wrapped, erase at the end of the row above
+		displayRow--;
+		displayCol = MAX_COL;
+	}
+	displayCol--;
+	putCell(displayRow, displayCol, data);
+	markCursor();
+}
+
+int ttyInput(char c) {
+	if (c == '\b') {
+		if (bufferTail == lineStart) // 最多退到行首
+			return 0;
+		bufferTail = (bufferTail + MAX_KEYBUFFER_SIZE - 1) % MAX_KEYBUFFER_SIZE;
+		ttyEcho(c);
+		return 0;
+	}
+	// a full ring drops the key, one slot is always kept for the '\n'
+	if ((bufferTail + 1) % MAX_KEYBUFFER_SIZE == bufferHead ||
+		(c != '\n' && (bufferTail + 2) % MAX_KEYBUFFER_SIZE == bufferHead))
+		return 0;
+	keyBuffer[bufferTail] = c;
+	bufferTail = (bufferTail + 1) % MAX_KEYBUFFER_SIZE;
+	ttyEcho(c);
+	if (c != '\n')
+		return 0;
+	lineStart = bufferTail;
+	return 1;
+}
+
+int ttyRead(char *dst, int size) {
+	int i = 0;
+	while (i < size && bufferHead != lineStart) {
+		dst[i] = keyBuffer[bufferHead];
+		bufferHead = (bufferHead + 1) % MAX_KEYBUFFER_SIZE;
+		if (dst[i++] == '\n')
+			break;
+	}
+	return i;
+}
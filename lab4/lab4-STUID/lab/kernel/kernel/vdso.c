@@ -0,0 +1,83 @@
+#include "x86.h"
+#include "device.h"
+
+/*
+ * Kernel data user code reads without a trap. VDSO_BASE of every user
+ * segment maps the one VdsoData page (clock, TSC rate, scheduler counters),
+ * the page after it is the process's own VdsoProc. Both are read-only in
+ * user mode, a store to them is a page fault that kills the process.
+ * VdsoData only changes in the kernel with seq odd meanwhile, so a reader
+ * that sees the same even seq before and after has a consistent copy.
+ */
+#define TSC_CAL_START 2 // tick 1 is the int $0x20 that starts the first process
+#define TSC_CAL_TICKS 10
+
+extern ProcessTable pcb[MAX_PCB_NUM];
+extern int current;
+extern uint32_t tickCount;
+
+static volatile VdsoData *vdso = (VdsoData *)VDSO_PHYS;
+static int hasTsc;
+static uint32_t calTsc;
+
+static volatile VdsoProc *vdsoProc(int pid) {
+	return (VdsoProc *)(segBase(USEL(2+pid*2)) + VDSO_BASE + PG_SIZE);
+}
+
+void initVdso() {
+	uint32_t linear;
+	int i;
+	for (i = 1; i < MAX_PCB_NUM; i++) {
+		linear = segBase(USEL(2+i*2)) + VDSO_BASE;
+		mapPages(linear, VDSO_PHYS, PG_SIZE, 0);
+		mapPages(linear + PG_SIZE, linear + PG_SIZE, PG_SIZE, 0);
+	}
+	memset((void *)vdso, 0, PG_SIZE);
+	vdso->hz = HZ;
+	hasTsc = (cpuidFeatures() & CPUID_TSC) != 0;
+}
+
+/* a new process's page, over whatever fork copied into it */
+void vdsoStart(int pid) {
+	volatile VdsoProc *p = vdsoProc(pid);
+	p->pid = pcb[pid].pid;
+	p->ticks = 0;
+	p->switches = 0;
+}
+
+void vdsoTick() {
+	uint32_t low, high;
+	int i, runnable = 0, blocked = 0;
+	for (i = 1; i < MAX_PCB_NUM; i++) {
+		if (pcb[i].state == STATE_RUNNABLE || pcb[i].state == STATE_RUNNING)
+			runnable++;
+		else if (pcb[i].state == STATE_BLOCKED)
+			blocked++;
+	}
+	vdso->seq++;
+	vdso->ticks = tickCount;
+	if (hasTsc) {
+		asm volatile("rdtsc" : "=a"(low), "=d"(high));
+		vdso->tscLow = low;
+		vdso->tscHigh = high;
+		if (tickCount == TSC_CAL_START)
+			calTsc = low;
+		else if (tickCount == TSC_CAL_START + TSC_CAL_TICKS)
+			vdso->tscPerTick = (low - calTsc) / TSC_CAL_TICKS;
+	}
+	if (current == 0)
+		vdso->idleTicks++;
+	else
+		vdsoProc(current)->ticks++;
+	vdso->runnable = runnable;
+	vdso->blocked = blocked;
+	vdso->seq++;
+}
+
+void vdsoSwitch(int pid) {
+	vdso->seq++;
+	vdso->switches++;
+	if (pid != 0)
+		vdsoProc(pid)->switches++;
+	vdso->seq++;
+}
@@ -1,32 +1,60 @@
 #include "x86.h"
 #include "device.h"
 
+/*
+ * The whole 32KB text window at 0xb8000 is used as a scrollback ring: the
+ * screen shows MAX_ROW rows starting at cell displayOrigin (CRTC start
+ * address), so scrolling is one register write plus clearing the new row.
+ * Only when the screen would run past the end of the window are its rows
+ * copied back to the start.
+ */
+#define VGA_BASE 0xb8000
+#define VGA_CELLS 0x4000 // 32KB of 2-byte cells
+
 int displayRow = 0; 
 int displayCol = 0;
 
-static uint16_t displayMem[MAX_ROW*MAX_COL];
+static int displayOrigin = 0; // cell shown at the top left corner
 static int displayClear = 0;
+static int cursorDirty = 0; // cursor moved since the last flushCursor()
+
+static void setOrigin(int origin) {
+	displayOrigin = origin;
+	outByte(0x3d4, 0x0c);
+	outByte(0x3d5, (unsigned char)((origin>>8) & 0xff));
+	outByte(0x3d4, 0x0d);
+	outByte(0x3d5, (unsigned char)(origin & 0xff));
+}
 
 void initVga() {
 	displayRow = 0;
 	displayCol = 0;
 	displayClear = 0;
+	setOrigin(0);
 	clearScreen();
 	updateCursor(0, 0);
 }
 
+void putCell(int row, int col, uint16_t data) {
+	int pos = (displayOrigin + row * MAX_COL + col) * 2;
+	asm volatile("movw %0, (%1)"::"r"(data),"r"(pos+VGA_BASE));
+}
+
+/* copies n ready-made cells to the screen with one string move */
+static void putCells(int row, int col, uint16_t *cells, int n) {
+	uint32_t pos = VGA_BASE + (displayOrigin + row * MAX_COL + col) * 2;
+	asm volatile("rep movsw" : "+S"(cells), "+D"(pos), "+c"(n) : : "memory");
+}
+
 void clearScreen() {
 	int i = 0;
-	int pos = 0;
 	uint16_t data = 0 | (0x0c << 8);
-	for (i = 0; i < MAX_ROW * MAX_COL; i++) {
-		pos = i * 2;
-		asm volatile("movw %0, (%1)"::"r"(data),"r"(pos+0xb8000));
-	}
+	for (i = 0; i < MAX_ROW * MAX_COL; i++)
+		putCell(0, i, data);
 }
 
 void updateCursor(int row, int col){
-	int cursorPos = row * MAX_COL + col;
+	int cursorPos = displayOrigin + row * MAX_COL + col;
 	outByte(0x3d4, 0x0f);
 	outByte(0x3d5, (unsigned char)(cursorPos & 0xff));
 
@@ -35,22 +63,59 @@ void updateCursor(int row, int col){
 }
 
 void scrollScreen() {
+	volatile uint16_t *vga = (uint16_t *)VGA_BASE;
 	int i = 0;
-	int pos = 0;
-	uint16_t data = 0;
-	for (i = 0; i < MAX_ROW * MAX_COL; i++) {
-		pos = i * 2;
-		asm volatile("movw (%1), %0":"=r"(data):"r"(pos+0xb8000));
-		displayMem[i] = data;
+	uint16_t data = 0 | (0x0c << 8);
+	if (displayOrigin + (MAX_ROW+1) * MAX_COL > VGA_CELLS) { // wrap around
+		memcpy((void *)vga, (void *)(vga + displayOrigin + MAX_COL), (MAX_ROW-1) * MAX_COL * 2);
+		setOrigin(0);
 	}
-	for (i = 0; i < (MAX_ROW-1) * MAX_COL; i++) {
-		pos = i * 2;
-		data = displayMem[i+MAX_COL];
-		asm volatile("movw %0, (%1)"::"r"(data),"r"(pos+0xb8000));
+	else
+		setOrigin(displayOrigin + MAX_COL);
+	for (i = 0; i < MAX_COL; i++)
+		putCell(MAX_ROW-1, i, data);
+}
+
+static void newLine() {
+	displayRow++;
+	displayCol = 0;
+	if (displayRow == MAX_ROW) {
+		displayRow = MAX_ROW-1;
+		scrollScreen();
 	}
-	data = 0 | (0x0c << 8);
-	for (i = (MAX_ROW-1) * MAX_COL; i < MAX_ROW * MAX_COL; i++) {
-		pos = i * 2;
-		asm volatile("movw %0, (%1)"::"r"(data),"r"(pos+0xb8000));
+}
+
+/* renders str the way stdout always has: every run of characters up to a
+ * '\n' or the end of the row is built up and copied in one go, and the
+ * cursor only follows at the next flushCursor() */
+void vgaWrite(const char *str, int size) {
+	uint16_t cells[MAX_COL];
+	int i = 0;
+	int n = 0;
+	while (i < size) {
+		if (str[i] == '\n') {
+			newLine();
+			i++;
+			continue;
+		}
+		for (n = 0; i < size && str[i] != '\n' && displayCol + n < MAX_COL; n++, i++)
+			cells[n] = (uint8_t)str[i] | (0x0c << 8);
+		putCells(displayRow, displayCol, cells, n);
+		displayCol += n;
+		if (displayCol == MAX_COL)
+			newLine();
 	}
+	cursorDirty = 1;
+}
+
+void markCursor() {
+	cursorDirty = 1;
+}
+
+/* called on every timer tick, the hardware cursor costs four port writes */
+void flushCursor() {
+	if (cursorDirty == 0)
+		return;
+	cursorDirty = 0;
+	updateCursor(displayRow, displayCol);
 }
@@ -0,0 +1,86 @@
+#include "common.h"
+#include "x86.h"
+#include "device.h"
+
+/*
+ * Kernel log. printk formats (vsnprintf) on its own stack and then appends the record
+ * "<level>text\n" to logBuf with interrupts off for the copy only, it never
+ * waits for a device. logHead and logDrain count bytes since boot, the ring
+ * holds the last LOG_SIZE of them; the SOFTIRQ_PRINTK bottom half sends the
+ * records up to LOG_CONSOLE_LEVEL to serial. Old records are overwritten
+ * when the drain falls behind, the log itself is what SYS_KLOG reads.
+ */
+#define LOG_SIZE 4096
+#define LOG_LINE 128
+
+static char logBuf[LOG_SIZE];
+static volatile uint32_t logHead = 0; // next byte written
+static uint32_t logDrain = 0; // next byte sent to serial
+
+void printk(int level, const char *fmt, ...) {
+	char line[LOG_LINE];
+	uint32_t eflags;
+	va_list ap;
+	int i, n;
+	line[0] = '<';
+	line[1] = '0' + level;
+	line[2] = '>';
+	va_start(ap, fmt);
+	n = 3 + vsnprintf(line + 3, LOG_LINE - 4, fmt, ap);
+	va_end(ap);
+	if (n > LOG_LINE - 2) // cut short
+		n = LOG_LINE - 2;
+	if (line[n-1] != '\n')
+		line[n++] = '\n';
+	asm volatile("pushfl; popl %0; cli":"=r"(eflags));
+	for (i = 0; i < n; i++)
+		logBuf[(logHead + i) % LOG_SIZE] = line[i];
+	logHead += n;
+	raiseSoftirq(SOFTIRQ_PRINTK);
+	if (eflags & 0x200)
+		enableInterrupt();
+}
+
+/* interrupts off: send what is new to serial, record by record */
+static void printkDrain(void) {
+	char line[LOG_LINE];
+	int n;
+	if (logHead - logDrain > LOG_SIZE) { // overwritten, resync at a record start
+		logDrain = logHead - LOG_SIZE;
+		while (logDrain != logHead && logBuf[logDrain % LOG_SIZE] != '<')
+			logDrain++;
+	}
+	while (logDrain != logHead) {
+		n = 0;
+		do {
+			line[n] = logBuf[(logDrain + n) % LOG_SIZE];
+		} while (line[n++] != '\n' && n < LOG_LINE && logDrain + n != logHead);
+		logDrain += n;
+		if (n > 3 && line[0] == '<' && line[1] - '0' <= LOG_CONSOLE_LEVEL)
+			serialWrite(line + 3, n - 3);
+	}
+}
+
+void printkSoftirq(void) {
+ disableInterrupt();
+	printkDrain();
+enableInterrupt();
+}
+
+void printkFlush(void) {
+	printkDrain();
+	serialFlush();
+}
+
+int printkRead(char *dst, int size) {
+	uint32_t start;
+	int i;
+	if (size <= 0)
+		return 0;
+	start = logHead > LOG_SIZE ? logHead - LOG_SIZE : 0;
+	if (logHead - start > (uint32_t)size)
+		start = logHead - size;
+	for (i = 0; start + i != logHead; i++)
+		dst[i] = logBuf[(start + i) % LOG_SIZE];
+	return i;
+}
@@ -2,18 +2,31 @@
 #include "x86.h"
 #include "device.h"
 
+extern char __bss_start[], _end[]; // from the linker
+
 void kEntry(void) {
+	char *p;
 
 	// Interruption is disabled in bootloader
 
+	for (p = __bss_start; p < _end; p++) // the bootloader copies the file as is, .bss included
+		*p = 0;
+
 	initSerial();// initialize serial port
 	initIdt(); // initialize idt
 	initIntr(); // iniialize 8259a
 	initSeg(); // initialize gdt, tss
+	initSysenter(); // fast system call entry, if the cpu has one
+	initPage(); // identity map low memory & enable paging
+	initVdso(); // map the read-only kernel data pages
 	initVga(); // initialize vga device
 	initTimer(); // initialize timer device
 	initKeyTable(); // initialize keyboard device
+	initTty(); // initialize console line discipline
 	initSem(); // initialize semaphore list
+	initFutex(); // initialize futex list
+	initShm(); // initialize shared memory list
+	initPipe(); // initialize pipe list
 	initDev(); // initialize device list
 	initProc(); // initialize pcb & load user program
 }
@@ -0,0 +1,294 @@
+#include "format.h"
+
+/*
+ * The engine writes through struct FormatOut: a chunk buffer that is either
+ * the caller's (snprintf: whatever does not fit is only counted) or a local
+ * one handed to a write callback whenever it fills up (vformat).
+ * Decimal conversion does two digits per division through digitPairs, and
+ * 64-bit values are divided with divl by hand since there is no libgcc.
+ */
+#define FORMAT_CHUNK 128
+
+#define FLAG_LEFT 0x1
+#define FLAG_ZERO 0x2
+#define FLAG_PLUS 0x4
+#define FLAG_SPACE 0x8
+#define FLAG_ALT 0x10
+
+struct FormatOut {
+	char *buf;
+	unsigned int size; // room in buf
+	unsigned int used; // bytes in buf
+	int total; // bytes produced so far
+	void (*write)(void *arg, const char *s, int n); // NULL: buf is all there is
+	void *arg;
+};
+
+static const char digitPairs[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static void emit(struct FormatOut *o, const char *s, int n) {
+	int i;
+	o->total += n;
+	for (i = 0; i < n; i++) {
+		if (o->used == o->size) {
+			if (o->write == 0)
+				return;
+			o->write(o->arg, o->buf, o->used);
+			o->used = 0;
+		}
+		o->buf[o->used++] = s[i];
+	}
+}
+
+static void pad(struct FormatOut *o, char c, int n) {
+	char fill[16];
+	int i;
+	for (i = 0; i < 16; i++)
+		fill[i] = c;
+	while (n > 0) {
+		emit(o, fill, n < 16 ? n : 16);
+		n -= 16;
+	}
+}
+
+/* *n /= base, returns the remainder; hi%base<base keeps divl from faulting */
+static unsigned int div64(unsigned long long *n, unsigned int base) {
+	unsigned int hi = (unsigned int)(*n >> 32);
+	unsigned int lo = (unsigned int)*n;
+	unsigned int rem = hi % base;
+	hi /= base;
+	asm("divl %4" : "=a"(lo), "=d"(rem) : "0"(lo), "1"(rem), "rm"(base));
+	*n = ((unsigned long long)hi << 32) | lo;
+	return rem;
+}
+
+/* writes val backwards ending at end, returns the first digit */
+static char *convert(char *end, unsigned long long val, unsigned int base, int upper) {
+	const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	unsigned int v, r;
+	if (base == 10) {
+		while (val >> 32) {
+			r = div64(&val, 100);
+			*--end = digitPairs[2*r+1];
+			*--end = digitPairs[2*r];
+		}
+		v = (unsigned int)val;
+		while (v >= 100) {
+			r = v % 100;
+			v /= 100;
+			*--end = digitPairs[2*r+1];
+			*--end = digitPairs[2*r];
+		}
+		if (v >= 10) {
+			*--end = digitPairs[2*v+1];
+			*--end = digitPairs[2*v];
+		}
+		else
+			*--end = '0' + v;
+		return end;
+	}
+	while (val >> 32)
+		*--end = digits[div64(&val, base)];
+	v = (unsigned int)val;
+	do {
+		*--end = digits[v % base];
+		v /= base;
+	} while (v != 0);
+	return end;
+}
+
+static void formatNumber(struct FormatOut *o, unsigned long long val, int negative,
+		unsigned int base, int upper, int flags, int width, int prec) {
+	char digits[24];
+	char prefix[3];
+	char *start = digits + sizeof(digits);
+	int len, zeros, plen = 0;
+	if (prec != 0 || val != 0) // "%.0d" of 0 prints nothing
+		start = convert(digits + sizeof(digits), val, base, upper);
+	len = digits + sizeof(digits) - start;
+	if (negative)
+		prefix[plen++] = '-';
+	else if (flags & FLAG_PLUS)
+		prefix[plen++] = '+';
+	else if (flags & FLAG_SPACE)
+		prefix[plen++] = ' ';
+	if ((flags & FLAG_ALT) && base == 8 && (len == 0 || *start != '0'))
+		prefix[plen++] = '0';
+	else if ((flags & FLAG_ALT) && base == 16 && val != 0) {
+		prefix[plen++] = '0';
+		prefix[plen++] = upper ? 'X' : 'x';
+	}
+	zeros = prec > len ? prec - len : 0;
+	if (prec < 0 && (flags & FLAG_ZERO) && !(flags & FLAG_LEFT) && width > plen + len)
+		zeros = width - plen - len;
+	width -= plen + zeros + len;
+	if (!(flags & FLAG_LEFT))
+		pad(o, ' ', width);
+	emit(o, prefix, plen);
+	pad(o, '0', zeros);
+	emit(o, start, len);
+	if (flags & FLAG_LEFT)
+		pad(o, ' ', width);
+}
+
+static void formatString(struct FormatOut *o, const char *s, int flags, int width, int prec) {
+	int len = 0;
+	if (s == 0)
+		s = "(null)";
+	while (s[len] != 0 && (prec < 0 || len < prec))
+		len++;
+	if (!(flags & FLAG_LEFT))
+		pad(o, ' ', width - len);
+	emit(o, s, len);
+	if (flags & FLAG_LEFT)
+		pad(o, ' ', width - len);
+}
+
+static void format(struct FormatOut *o, const char *fmt, va_list ap) {
+	const char *run;
+	int flags, width, prec, lng;
+	unsigned long long val;
+	long long sval;
+	char c;
+	while (*fmt != 0) {
+		for (run = fmt; *fmt != 0 && *fmt != '%'; fmt++);
+		emit(o, run, fmt - run);
+		if (*fmt == 0)
+			break;
+		fmt++;
+		for (flags = 0; ; fmt++) {
+			if (*fmt == '-') flags |= FLAG_LEFT;
+			else if (*fmt == '0') flags |= FLAG_ZERO;
+			else if (*fmt == '+') flags |= FLAG_PLUS;
+			else if (*fmt == ' ') flags |= FLAG_SPACE;
+			else if (*fmt == '#') flags |= FLAG_ALT;
+			else break;
+		}
+		width = 0;
+		if (*fmt == '*') {
+			width = va_arg(ap, int);
+			if (width < 0) {
+				flags |= FLAG_LEFT;
+				width = -width;
+			}
+			fmt++;
+		}
+		else {
+			for (; *fmt >= '0' && *fmt <= '9'; fmt++)
+				width = width * 10 + *fmt - '0';
+		}
+		prec = -1;
+		if (*fmt == '.') {
+			fmt++;
+			prec = 0;
+			if (*fmt == '*') {
+				prec = va_arg(ap, int);
+				fmt++;
+			}
+			else {
+				for (; *fmt >= '0' && *fmt <= '9'; fmt++)
+					prec = prec * 10 + *fmt - '0';
+			}
+		}
+		lng = 0; // -2 hh, -1 h, 1 l, 2 ll
+		for (; *fmt == 'h'; fmt++)
+			lng--;
+		for (; *fmt == 'l'; fmt++)
+			lng++;
+		switch (c = *fmt++) {
+			case 'd':
+			case 'i':
+				if (lng >= 2)
+					sval = va_arg(ap, long long);
+				else
+					sval = va_arg(ap, int);
+				if (lng == -1)
+					sval = (short)sval;
+				else if (lng <= -2)
+					sval = (signed char)sval;
+				val = sval < 0 ? -(unsigned long long)sval : (unsigned long long)sval;
+				formatNumber(o, val, sval < 0, 10, 0, flags, width, prec);
+				break;
+			case 'u':
+			case 'o':
+			case 'x':
+			case 'X':
+				if (lng >= 2)
+					val = va_arg(ap, unsigned long long);
+				else
+					val = va_arg(ap, unsigned int);
+				if (lng == -1)
+					val = (unsigned short)val;
+				else if (lng <= -2)
+					val = (unsigned char)val;
+				formatNumber(o, val, 0, c == 'u' ? 10 : (c == 'o' ? 8 : 16), c == 'X',
+					flags & ~(FLAG_PLUS | FLAG_SPACE), width, prec);
+				break;
+			case 'p':
+				val = (unsigned int)va_arg(ap, void *);
+				formatNumber(o, val, 0, 16, 0, flags | FLAG_ALT, width, prec);
+				break;
+			case 'c':
+				c = (char)va_arg(ap, int);
+				if (!(flags & FLAG_LEFT))
+					pad(o, ' ', width - 1);
+				emit(o, &c, 1);
+				if (flags & FLAG_LEFT)
+					pad(o, ' ', width - 1);
+				break;
+			case 's':
+				formatString(o, va_arg(ap, const char *), flags, width, prec);
+				break;
+			case '%':
+				emit(o, "%", 1);
+				break;
+			case 0: // lone '%' at the end
+				return;
+			default: // unknown conversion, print it as is
+				emit(o, fmt - 1, 1);
+				break;
+		}
+	}
+}
+
+int vsnprintf(char *buf, unsigned int size, const char *fmt, va_list ap) {
+	struct FormatOut o;
+	o.buf = buf;
+	o.size = size == 0 ? 0 : size - 1;
+	o.used = 0;
+	o.total = 0;
+	o.write = 0;
+	o.arg = 0;
+	format(&o, fmt, ap);
+	if (size != 0)
+		buf[o.used] = 0;
+	return o.total;
+}
+
+int snprintf(char *buf, unsigned int size, const char *fmt, ...) {
+	va_list ap;
+	int n;
+	va_start(ap, fmt);
+	n = vsnprintf(buf, size, fmt, ap);
+	va_end(ap);
+	return n;
+}
+
+int vformat(void (*write)(void *arg, const char *s, int n), void *arg,
+		const char *fmt, va_list ap) {
+	char chunk[FORMAT_CHUNK];
+	struct FormatOut o;
+	o.buf = chunk;
+	o.size = FORMAT_CHUNK;
+	o.used = 0;
+	o.total = 0;
+	o.write = write;
+	o.arg = arg;
+	format(&o, fmt, ap);
+	if (o.used != 0)
+		write(arg, chunk, o.used);
+	return o.total;
+}
@@ -0,0 +1,23 @@
+#ifndef __FORMAT_H__
+#define __FORMAT_H__
+
+#include <stdarg.h>
+
+/*
+ * printf-style formatting shared by the kernel (printk) and lib (printf).
+ * Conversions: %d %i %u %o %x %X %p %c %s %%, flags - 0 + space #, width
+ * and precision (also *), lengths hh h l ll.
+ */
+
+/* formats into buf (always NUL terminated when size>0), returns the length
+ * the whole output would have had */
+int vsnprintf(char *buf, unsigned int size, const char *fmt, va_list ap);
+
+int snprintf(char *buf, unsigned int size, const char *fmt, ...);
+
+/* formats in pieces handed to write(arg, piece, length), for output of any
+ * length; returns the total length */
+int vformat(void (*write)(void *arg, const char *s, int n), void *arg,
+		const char *fmt, va_list ap);
+
+#endif
@@ -2,6 +2,7 @@
 #define __lib_h__
 
 #include "types.h"
+#include "format.h"
 
 #define SYS_WRITE 0
 #define SYS_READ 1
@@ -10,6 +11,16 @@
 #define SYS_SLEEP 4
 #define SYS_EXIT 5
 #define SYS_SEM 6
+#define SYS_FUTEX 7
+#define SYS_SHM 8
+#define SYS_PIPE 9
+#define SYS_CLOSE 10
+#define SYS_IPC 11
+#define SYS_POLL 12
+#define SYS_CONSOLE 13
+#define SYS_KLOG 14
+#define SYS_SBRK 15
+#define SYS_RING 16
 
 #define STD_OUT 0
 #define STD_IN 1
@@ -18,13 +29,131 @@
 #define SEM_WAIT 1
 #define SEM_POST 2
 #define SEM_DESTROY 3
+#define SEM_OP 4
+#define SEM_TIMEDWAIT 5
+#define SEM_STAT 6
+#define SEM_TRYWAIT 7
+
+#define SEM_TIMEOUT 1
+
+#define SEM_WAKE 0
+#define SEM_HANDOFF 1
+
+#define IPC_CALL 0
+#define IPC_REPLY_WAIT 1
+
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+
+#define SHM_CREATE 0
+#define SHM_ATTACH 1
+#define SHM_DETACH 2
+
+#define RING_SETUP 0
+#define RING_ENTER 1
+
+#define RING_WRITE 0 // a1 fd, a2 buf, a3 size
+#define RING_SEM_POST 1 // a1 sem_t
+#define RING_SEM_TRYWAIT 2 // a1 sem_t
+#define RING_SLEEP 3 // a1 ticks
+
+#define POLLIN 0x1
+#define POLLOUT 0x4
+#define POLLHUP 0x10
+#define POLLNVAL 0x20
+#define POLLSEM 0x100
+
+#define CONSOLE_VGA 1
+#define CONSOLE_SERIAL 2
 
 #define MAX_BUFFER_SIZE 256
 
+#define VDSO_BASE 0x7e000
+#define VDSO ((const volatile struct vdso *)VDSO_BASE)
+#define VDSO_PROC ((const volatile struct vdsoproc *)(VDSO_BASE + 0x1000))
+
+#define EOF (-1)
+
+#define _IOFBF 0 // flush when full
+#define _IOLBF 1 // flush at every '\n'
+#define _IONBF 2 // no buffering
+
+extern FILE *stdout;
+extern FILE *stdin;
+
+int write(int fd, const void *buf, uint32_t size);
+
+/* on STD_IN blocks until a whole line is typed and returns it with its '\n',
+ * plus any other finished lines that fit, NUL terminated (at most size-1
+ * bytes, the rest is left for the next read) */
+int read(int fd, void *buf, uint32_t size);
+
+/* fd[0] is the read end, fd[1] the write end; both are inherited by fork */
+int pipe(int fd[2]);
+
+int close(int fd);
+
+/* waits until one of fds[0..n) is ready (at most 8), for at most timeout
+ * ticks (<0: no limit); returns how many have revents set, 0 on timeout.
+ * A semaphore entry only reports POLLIN, it still has to be sem_wait'ed */
+int poll(struct pollfd *fds, uint32_t n, int timeout);
+
+/* sends msg to server dst and blocks until it replies, the reply overwrites
+ * msg; returns 0, or -1 if dst does not exist or died */
+int ipc_call(pid_t dst, struct ipcmsg *msg);
+
+/* replies msg to client (-1: nobody to reply to) and waits for the next call,
+ * which overwrites msg; returns the pid of the caller to reply to next */
+pid_t ipc_reply_wait(pid_t client, struct ipcmsg *msg);
+
+/* sends stdout (and the echo of typed keys) to CONSOLE_VGA, CONSOLE_SERIAL
+ * or both; 0 leaves it as is. Returns the previous mode */
+int console_mode(int mode);
+
+/* copies the newest size bytes of the kernel log ("<level>text\n" records,
+ * at most 4KB are kept), returns the count */
+int klog(char *buf, uint32_t size);
+
+/* stdout: line buffered; flushed by exit() and before fork(). The
+ * conversions are the ones of vsnprintf (format.h) */
 int printf(const char *format,...);
 
+uint32_t fwrite(const void *ptr, uint32_t size, uint32_t nmemb, FILE *stream);
+
+int fflush(FILE *stream); // NULL: every stream
+
+int setvbuf(FILE *stream, char *buf, int mode, uint32_t size);
+
+/* a fully buffered stream on fd (a pipe end), at most 3 of them */
+FILE *fdopen(int fd);
+
+int fclose(FILE *stream);
+
+int fputc(int c, FILE *stream);
+
+int putchar(int c);
+
+int fputs(const char *s, FILE *stream);
+
+int puts(const char *s);
+
+/* stdin is one buffer shared by scanf, getchar, fgets and getline: input
+ * read but not consumed by one call is there for the next, so a refill (and
+ * a trap) only happens once it is used up. Reading flushes stdout first */
 int scanf(const char *format,...);
 
+int fgetc(FILE *stream);
+
+int getchar();
+
+/* reads up to and including '\n', at most size-1 bytes; NULL at end of input */
+char *fgets(char *s, int size, FILE *stream);
+
+/* reads a whole line with its '\n' into *lineptr (NUL terminated), growing it
+ * with realloc and updating *size as needed, a NULL *lineptr is allocated.
+ * Returns the length of the line, EOF at end of input or out of memory */
+int getline(char **lineptr, uint32_t *size, FILE *stream);
+
 pid_t fork();
 
 int exec(void (*func)(void));
@@ -39,6 +168,93 @@ int sem_wait(sem_t *sem);
 
 int sem_post(sem_t *sem);
 
+/* like sem_post, but switches to the woken waiter right away */
+int sem_post_handoff(sem_t *sem);
+
 int sem_destroy(sem_t *sem);
 
+/* waits at most ticks timer ticks: 0 acquired, SEM_TIMEOUT timed out, -1 error */
+int sem_timedwait(sem_t *sem, uint32_t ticks);
+
+/* never blocks: 0 acquired, SEM_TIMEOUT if it would have to wait, -1 error */
+int sem_trywait(sem_t *sem);
+
+/* applies every op in ops[0..n) atomically, blocking until all the waits
+ * (op<0) can be satisfied at once; at most 6 ops */
+int semop(struct sembuf *ops, uint32_t n);
+
+/* copies the contention counters of sem[index] into st; returns 1 if the
+ * semaphore is in use, 0 if not (counters of a destroyed one are kept),
+ * -1 past the last index */
+int sem_stat(int index, struct semstat *st);
+
+/* prints the counters of every semaphore that has been used */
+void sem_dump();
+
+/* on!=0: exit() calls sem_dump() first, in this process and its later children */
+void sem_profile(int on);
+
+int futex_wait(volatile int32_t *addr);
+
+int futex_wake(volatile int32_t *addr);
+
+/* futex-based semaphore: the count must live in shared memory (shm_attach)
+ * to be seen by several processes, only contention enters the kernel */
+int fsem_init(fsem_t *sem, int32_t value);
+
+int fsem_wait(fsem_t *sem);
+
+int fsem_post(fsem_t *sem);
+
+/* returns the id of a new shared memory segment of at most 64KB, or -1 */
+int shm_create(uint32_t size);
+
+/* maps segment id into this process, the address is the same in every
+ * process and children inherit the mapping; returns 0 on failure */
+void *shm_attach(int id);
+
+int shm_detach(int id);
+
+/* moves the end of the heap by incr bytes, the new part reads as 0; returns
+ * the old end, or (void *)-1 if the heap would shrink past the end of the
+ * program or grow into the vdso pages (VDSO_BASE) */
+void *sbrk(int32_t incr);
+
+/* registers r for batched system calls and empties it; r stays in use until
+ * the next ring_setup, children use their copy at the same address */
+int ring_setup(struct ring *r);
+
+/* queues one RING_* op, no system call; -1 if the submission queue is full.
+ * RING_WRITE goes straight to the fd, past the stdio buffers */
+int ring_push(struct ring *r, uint32_t op, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t data);
+
+/* runs the queued ops in order with one trap, each one exactly as its own
+ * system call would (a RING_SLEEP sleeps); stops early when the completion
+ * queue fills up. Returns how many ran, -1 without a ring */
+int ring_enter();
+
+/* takes the oldest completion into *c, no system call; 0 if there is none */
+int ring_pop(struct ring *r, struct ringcqe *c);
+
+/* read straight from the kernel's pages (VDSO, VDSO_PROC), no system call */
+pid_t getpid();
+
+uint32_t get_ticks();
+
+/* microseconds since boot: ticks refined by the TSC once the kernel has
+ * calibrated it, tick granularity before that or without one */
+uint64_t uptime_us();
+
+/* a consistent copy of the whole VDSO page */
+void vdso_read(struct vdso *copy);
+
+/* blocks of up to 508 bytes come from per-size free lists, larger ones
+ * from a coalescing free list; all of them are 8-byte aligned */
+void *malloc(uint32_t size);
+
+void free(void *ptr);
+
+/* grows in place when the next block is free, copies otherwise */
+void *realloc(void *ptr, uint32_t size);
+
 #endif
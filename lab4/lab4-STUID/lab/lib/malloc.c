@@ -0,0 +1,224 @@
+#include "lib.h"
+#include "types.h"
+#include "string.h"
+
+/*
+ * Heap on top of sbrk(). Requests that fit a slot of 16..512 bytes (4 of
+ * them header) are served from one free list per size class: a free is a
+ * push, a malloc a pop, and an empty list is refilled by carving a 4KB slab
+ * into slots. Processes have a single thread, so these lists are the whole
+ * "thread cache"; slots are never given back to the large heap.
+ *
+ * Everything else is a large block with its size in both a header and a
+ * footer word, bit 0 set while in use, so free() merges it with free
+ * neighbours on either side. Free large blocks sit on a doubly linked list
+ * searched first fit. Every sbrk'ed region is closed by a used footer word
+ * before its first block and a used header word (size 0) after its last
+ * one; a region growing right after the previous one starts at that end
+ * word, so the two join. Block headers sit at 4 mod 8, payloads are 8-byte
+ * aligned.
+ */
+#define USED 0x1
+#define SMALL 0x2 // slot header: class << 3 | SMALL | USED
+
+#define NR_CLASS 6
+#define SMALL_MAX (16 << (NR_CLASS - 1))
+#define SLAB_SIZE 4096
+#define CORE_SIZE 0x4000 // the heap grows by at least 16KB at a time
+#define MIN_BLOCK 16 // header, next, prev, footer
+#define MAX_ALLOC 0x100000
+
+#define HDR(b) (*(uint32_t *)(b))
+#define SIZE(b) (HDR(b) & ~7u)
+#define FTR(b) (*(uint32_t *)((b) + SIZE(b) - 4))
+#define NEXT(b) (*(char **)((b) + 4))
+#define PREV(b) (*(char **)((b) + 8))
+
+static char *freeSmall[NR_CLASS];
+static char *freeLarge;
+static char *coreEnd; // current break, as far as malloc knows
+static char *coreLast; // end word of the last region
+
+static void listInsert(char *b) {
+	NEXT(b) = freeLarge;
+	PREV(b) = 0;
+	if (freeLarge != 0)
+		PREV(freeLarge) = b;
+	freeLarge = b;
+}
+
+static void listRemove(char *b) {
+	if (PREV(b) != 0)
+		NEXT(PREV(b)) = NEXT(b);
+	else
+		freeLarge = NEXT(b);
+	if (NEXT(b) != 0)
+		PREV(NEXT(b)) = PREV(b);
+}
+
+/* frees the used large block b, merging it with its free neighbours */
+static void release(char *b) {
+	uint32_t size = SIZE(b);
+	uint32_t prev = *(uint32_t *)(b - 4);
+	char *next = b + size;
+	if (!(HDR(next) & USED)) {
+		listRemove(next);
+		size += SIZE(next);
+	}
+	if (!(prev & USED)) {
+		b -= prev;
+		listRemove(b);
+		size += SIZE(b);
+	}
+	HDR(b) = size;
+	FTR(b) = size;
+	listInsert(b);
+}
+
+/* shrinks the used block b to need bytes, freeing the tail if it is big enough */
+static void split(char *b, uint32_t need) {
+	uint32_t size = SIZE(b);
+	if (size - need < MIN_BLOCK)
+		return;
+	HDR(b) = need | USED;
+	FTR(b) = need | USED;
+	HDR(b + need) = (size - need) | USED;
+	FTR(b + need) = (size - need) | USED;
+	release(b + need);
+}
+
+static int moreCore(uint32_t need) {
+	uint32_t n = (need + 16 + CORE_SIZE - 1) & ~(CORE_SIZE - 1);
+	uint32_t size;
+	char *p = sbrk(n);
+	char *b;
+	if (p == (char *)-1) {
+		n = need + 16;
+		if ((p = sbrk(n)) == (char *)-1)
+			return -1;
+	}
+	if (p == coreEnd && coreLast != 0) // right after the last region: join it
+		b = coreLast;
+	else {
+		b = (char *)(((uint32_t)p + 7) & ~7u);
+		*(uint32_t *)b = USED;
+		b += 4;
+	}
+	coreEnd = p + n;
+	size = ((uint32_t)coreEnd - 4 - (uint32_t)b) & ~7u;
+	HDR(b) = size | USED;
+	FTR(b) = size | USED;
+	coreLast = b + size;
+	HDR(coreLast) = USED;
+	release(b);
+	return 0;
+}
+
+/* a used large block of at least need bytes, header and footer included */
+static char *largeAlloc(uint32_t need) {
+	char *b;
+	while (1) {
+		for (b = freeLarge; b != 0; b = NEXT(b)) {
+			if (SIZE(b) >= need) {
+				listRemove(b);
+				HDR(b) |= USED;
+				FTR(b) |= USED;
+				split(b, need);
+				return b;
+			}
+		}
+		if (moreCore(need) == -1)
+			return 0;
+	}
+}
+
+static int slabRefill(int cls) {
+	uint32_t slot = 16 << cls;
+	char *slab = largeAlloc(SLAB_SIZE);
+	char *end;
+	char *b;
+	if (slab == 0)
+		return -1;
+	end = slab + SIZE(slab) - 4;
+	for (b = slab + 8; b + slot <= end; b += slot) {
+		HDR(b) = (cls << 3) | SMALL | USED;
+		NEXT(b) = freeSmall[cls];
+		freeSmall[cls] = b;
+	}
+	return 0;
+}
+
+static uint32_t largeSize(uint32_t size) {
+	uint32_t need = (size + 8 + 7) & ~7u;
+	return need < MIN_BLOCK ? MIN_BLOCK : need;
+}
+
+void *malloc(uint32_t size) {
+	uint32_t need;
+	int cls;
+	char *b;
+	if (size == 0 || size > MAX_ALLOC)
+		return 0;
+	need = (size + 4 + 7) & ~7u;
+	if (need <= SMALL_MAX) {
+		for (cls = 0; (16u << cls) < need; cls++);
+		if (freeSmall[cls] == 0 && slabRefill(cls) == -1)
+			return 0;
+		b = freeSmall[cls];
+		freeSmall[cls] = NEXT(b);
+		return b + 4;
+	}
+	b = largeAlloc(largeSize(size));
+	return b == 0 ? 0 : b + 4;
+}
+
+void free(void *ptr) {
+	char *b = (char *)ptr - 4;
+	int cls;
+	if (ptr == 0)
+		return;
+	if (HDR(b) & SMALL) {
+		cls = HDR(b) >> 3;
+		NEXT(b) = freeSmall[cls];
+		freeSmall[cls] = b;
+		return;
+	}
+	release(b);
+}
+
+void *realloc(void *ptr, uint32_t size) {
+	char *b = (char *)ptr - 4;
+	char *next;
+	char *q;
+	uint32_t have, need;
+	if (ptr == 0)
+		return malloc(size);
+	if (size == 0) {
+		free(ptr);
+		return 0;
+	}
+	if (HDR(b) & SMALL)
+		have = (16u << (HDR(b) >> 3)) - 4;
+	else {
+		need = size > MAX_ALLOC ? MAX_ALLOC : largeSize(size);
+		next = b + SIZE(b);
+		if (SIZE(b) < need && !(HDR(next) & USED) && SIZE(b) + SIZE(next) >= need) {
+			listRemove(next);
+			need = SIZE(b) + SIZE(next);
+			HDR(b) = need | USED;
+			FTR(b) = need | USED;
+		}
+		have = SIZE(b) - 8;
+	}
+	if (size <= have) {
+		if (!(HDR(b) & SMALL))
+			split(b, largeSize(size));
+		return ptr;
+	}
+	q = malloc(size);
+	if (q == 0)
+		return 0;
+	memcpy(q, ptr, have);
+	free(ptr);
+	return q;
+}
@@ -0,0 +1,201 @@
+#include "lib.h"
+#include "types.h"
+
+/*
+ * Buffered streams on top of write(). stdout is line buffered, so a printf
+ * or putchar only traps when a line is complete or BUFSIZ bytes are pending;
+ * fdopen'ed streams (pipes) are fully buffered. Everything is flushed by
+ * exit() and before fork(), so no output is lost or printed twice.
+ *
+ * Input goes the other way: fillBuffer() reads as much as one read() gives
+ * (every finished line on stdin) and scanf, fgetc, fgets and getline all
+ * consume from buf[pos..count), so what one call leaves is there for the
+ * next. buf[count] is kept 0, scanf's helpers refill when they reach it.
+ */
+#define MAX_FILE 5
+
+static char stdoutBuf[BUFSIZ];
+static char stdinBuf[BUFSIZ];
+static char fileBuf[MAX_FILE-2][BUFSIZ];
+
+static FILE files[MAX_FILE] = {
+	{STD_OUT, _IOLBF, 0, BUFSIZ, stdoutBuf, 0, 0},
+	{STD_IN, _IOLBF, 0, BUFSIZ, stdinBuf, 0, 1},
+	{-1, _IOFBF, 0, 0, 0, 0, 0},
+	{-1, _IOFBF, 0, 0, 0, 0, 0},
+	{-1, _IOFBF, 0, 0, 0, 0, 0},
+};
+
+FILE *stdout = &files[0];
+FILE *stdin = &files[1];
+
+int fflush(FILE *stream) {
+	int i, ret = 0;
+	if (stream == 0) {
+		for (i = 0; i < MAX_FILE; i++) {
+			if (files[i].fd != -1 && fflush(&files[i]) == EOF)
+				ret = EOF;
+		}
+		return ret;
+	}
+	if (stream->reading) // unread input stays for the next read
+		return 0;
+	if (stream->count != 0 && write(stream->fd, stream->buf, stream->count) < 0)
+		ret = EOF;
+	stream->count = 0;
+	return ret;
+}
+
+uint32_t fwrite(const void *ptr, uint32_t size, uint32_t nmemb, FILE *stream) {
+	const char *str = (const char *)ptr;
+	uint32_t n = size * nmemb;
+	uint32_t i;
+	int newline = 0;
+	if (n == 0)
+		return 0;
+	if (stream->reading) { // unread input is dropped
+		stream->reading = 0;
+		stream->count = 0;
+	}
+	if (stream->mode == _IONBF)
+		return write(stream->fd, str, n) < 0 ? 0 : nmemb;
+	for (i = 0; i < n; i++) {
+		if (stream->count == stream->size && fflush(stream) == EOF)
+			return i / size;
+		stream->buf[stream->count++] = str[i];
+		if (str[i] == '\n')
+			newline = 1;
+	}
+	if (newline && stream->mode == _IOLBF && fflush(stream) == EOF)
+		return 0;
+	return nmemb;
+}
+
+int setvbuf(FILE *stream, char *buf, int mode, uint32_t size) {
+	if (mode < _IOFBF || mode > _IONBF || fflush(stream) == EOF)
+		return -1;
+	if (buf != 0 && size != 0) {
+		stream->buf = buf;
+		stream->size = size;
+	}
+	stream->mode = mode;
+	return 0;
+}
+
+FILE *fdopen(int fd) {
+	int i;
+	for (i = 2; i < MAX_FILE; i++) {
+		if (files[i].fd == -1)
+			break;
+	}
+	if (i == MAX_FILE)
+		return 0;
+	files[i].fd = fd;
+	files[i].mode = _IOFBF;
+	files[i].count = 0;
+	files[i].size = BUFSIZ;
+	files[i].buf = fileBuf[i-2];
+	files[i].pos = 0;
+	files[i].reading = 0;
+	return &files[i];
+}
+
+int fclose(FILE *stream) {
+	int ret = fflush(stream);
+	if (stream != stdout && stream != stdin) {
+		close(stream->fd);
+		stream->fd = -1;
+	}
+	return ret;
+}
+
+int fputc(int c, FILE *stream) {
+	char ch = (char)c;
+	return fwrite(&ch, 1, 1, stream) == 1 ? (uint8_t)ch : EOF;
+}
+
+int putchar(int c) {
+	return fputc(c, stdout);
+}
+
+int fputs(const char *s, FILE *stream) {
+	uint32_t n = 0;
+	while (s[n] != 0)
+		n++;
+	return fwrite(s, 1, n, stream) == n ? 0 : EOF;
+}
+
+int puts(const char *s) {
+	if (fputs(s, stdout) == EOF)
+		return EOF;
+	return fputc('\n', stdout) == EOF ? EOF : 0;
+}
+
+int fillBuffer(FILE *stream) {
+	int n;
+	if (!stream->reading) {
+		if (fflush(stream) == EOF)
+			return -1;
+		stream->reading = 1;
+	}
+	if (stream->fd == STD_IN)
+		fflush(stdout); // show the prompt before blocking
+	n = read(stream->fd, stream->buf, stream->size - 1);
+	if (n < 0)
+		n = 0;
+	stream->buf[n] = 0;
+	stream->count = n;
+	stream->pos = 0;
+	return n;
+}
+
+int fgetc(FILE *stream) {
+	if ((!stream->reading || stream->pos == stream->count) && fillBuffer(stream) <= 0)
+		return EOF;
+	return (uint8_t)stream->buf[stream->pos++];
+}
+
+int getchar() {
+	return fgetc(stdin);
+}
+
+char *fgets(char *s, int size, FILE *stream) {
+	int i = 0;
+	int c = 0;
+	if (size <= 0)
+		return 0;
+	while (i < size - 1 && c != '\n') {
+		if ((c = fgetc(stream)) == EOF)
+			break;
+		s[i++] = c;
+	}
+	if (i == 0 && c == EOF)
+		return 0;
+	s[i] = 0;
+	return s;
+}
+
+int getline(char **lineptr, uint32_t *size, FILE *stream) {
+	uint32_t n = 0;
+	uint32_t grow;
+	char *p;
+	int c;
+	if (*lineptr == 0)
+		*size = 0;
+	while ((c = fgetc(stream)) != EOF) {
+		if (n + 1 >= *size) { // room for c and the NUL
+			grow = *size < 64 ? 64 : *size * 2;
+			if ((p = realloc(*lineptr, grow)) == 0)
+				return EOF;
+			*lineptr = p;
+			*size = grow;
+		}
+		(*lineptr)[n++] = c;
+		if (c == '\n')
+			break;
+	}
+	if (n == 0)
+		return EOF;
+	(*lineptr)[n] = 0;
+	return n;
+}
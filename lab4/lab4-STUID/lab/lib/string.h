@@ -0,0 +1,90 @@
+#ifndef __STRING_H__
+#define __STRING_H__
+
+/*
+ * Memory and string routines shared by the kernel, lib and the bootloader,
+ * all inline so each user only pays for what it calls. Copies and fills go
+ * a word at a time with rep movsl/stosl; a length known at compile time to
+ * be a multiple of 4 gets the bare string instruction, longer runs first
+ * move a few bytes to word-align the destination. They write through %es
+ * and expect it to equal %ds (the kernel loads both on entry) and the
+ * direction flag clear.
+ */
+
+static inline void *memcpy(void *dst, const void *src, unsigned int n) {
+	unsigned int d0, d1, d2;
+	unsigned int head = 0;
+	if (__builtin_constant_p(n) && (n & 3) == 0) {
+		asm volatile("rep movsl"
+			: "=&c"(d0), "=&D"(d1), "=&S"(d2)
+			: "0"(n >> 2), "1"(dst), "2"(src) : "memory");
+		return dst;
+	}
+	if (n >= 16)
+		head = -(unsigned int)dst & 3;
+	n -= head;
+	asm volatile("rep movsb\n\t"
+		"movl %4, %%ecx\n\t"
+		"shrl $2, %%ecx\n\t"
+		"rep movsl\n\t"
+		"movl %4, %%ecx\n\t"
+		"andl $3, %%ecx\n\t"
+		"rep movsb"
+		: "=&c"(d0), "=&D"(d1), "=&S"(d2)
+		: "0"(head), "rm"(n), "1"(dst), "2"(src) : "memory");
+	return dst;
+}
+
+static inline void *memset(void *dst, int c, unsigned int n) {
+	unsigned int d0, d1;
+	unsigned int head = 0;
+	unsigned int word = (unsigned char)c * 0x01010101u;
+	if (__builtin_constant_p(n) && (n & 3) == 0) {
+		asm volatile("rep stosl"
+			: "=&c"(d0), "=&D"(d1)
+			: "0"(n >> 2), "1"(dst), "a"(word) : "memory");
+		return dst;
+	}
+	if (n >= 16)
+		head = -(unsigned int)dst & 3;
+	n -= head;
+	asm volatile("rep stosb\n\t"
+		"movl %3, %%ecx\n\t"
+		"shrl $2, %%ecx\n\t"
+		"rep stosl\n\t"
+		"movl %3, %%ecx\n\t"
+		"andl $3, %%ecx\n\t"
+		"rep stosb"
+		: "=&c"(d0), "=&D"(d1)
+		: "0"(head), "rm"(n), "1"(dst), "a"(word) : "memory");
+	return dst;
+}
+
+/* overlapping ranges are fine: a forward copy unless dst is inside src */
+static inline void *memmove(void *dst, const void *src, unsigned int n) {
+	unsigned int d0, d1, d2;
+	if ((unsigned int)dst - (unsigned int)src >= n)
+		return memcpy(dst, src, n);
+	asm volatile("std\n\t"
+		"rep movsl\n\t"
+		"movl %3, %%ecx\n\t"
+		"andl $3, %%ecx\n\t"
+		"addl $3, %%esi\n\t"
+		"addl $3, %%edi\n\t"
+		"rep movsb\n\t"
+		"cld"
+		: "=&c"(d0), "=&D"(d1), "=&S"(d2)
+		: "rm"(n), "0"(n >> 2), "1"((char *)dst + n - 4),
+		  "2"((const char *)src + n - 4) : "memory");
+	return dst;
+}
+
+static inline unsigned int strlen(const char *s) {
+	unsigned int d0, n;
+	asm volatile("repne scasb"
+		: "=c"(n), "=&D"(d0)
+		: "0"(0xffffffffu), "1"(s), "a"(0) : "memory");
+	return ~n - 1;
+}
+
+#endif
@@ -4,6 +4,41 @@
  * io lib here
  * 库函数写在这
  */
+#define CPUID_SEP 0x800
+
+static int sysenterOk = -1; // -1: cpu not asked yet
+
+/* whether the cpu has sysenter (the kernel enables it under the same test) */
+static int hasSysenter() {
+	uint32_t a, b, c, d, flags;
+	asm volatile("pushfl; popl %0; movl %0, %1; xorl $0x200000, %0;"
+		"pushl %0; popfl; pushfl; popl %0; pushl %1; popfl"
+		: "=&r"(a), "=&r"(flags));
+	if (((a ^ flags) & 0x200000) == 0) // no cpuid
+		return 0;
+	asm volatile("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1));
+	if (((a >> 8) & 0xf) == 6 && ((a >> 4) & 0xf) < 3 && (a & 0xf) < 3) // Pentium Pro
+		return 0;
+	return (d & CPUID_SEP) != 0;
+}
+
+/* the kernel returns with iret to the eip pushed here, the stack pointer
+ * travels in ebp; every other register comes back as it was */
+static inline int32_t sysenterCall(int num, uint32_t a1, uint32_t a2,
+		uint32_t a3, uint32_t a4, uint32_t a5) {
+	int32_t ret;
+	asm volatile("pushl %%ebp\n\t"
+		"pushl $1f\n\t"
+		"movl %%esp, %%ebp\n\t"
+		"sysenter\n"
+		"1:\n\t"
+		"popl %%ebp"
+		: "=a"(ret)
+		: "a"(num), "c"(a1), "d"(a2), "b"(a3), "S"(a4), "D"(a5)
+		: "memory", "cc");
+	return ret;
+}
+
 //static inline int32_t syscall(int num, uint32_t a1,uint32_t a2,
 int32_t syscall(int num, uint32_t a1,uint32_t a2,
 		uint32_t a3, uint32_t a4, uint32_t a5)
@@ -12,6 +47,10 @@ int32_t syscall(int num, uint32_t a1,uint32_t a2,
 	uint32_t eax, ecx, edx, ebx, esi, edi;
 	//uint16_t selector;
 	
+	if (sysenterOk == -1)
+		sysenterOk = hasSysenter();
+	if (sysenterOk) // int $0x80 below stays for cpus without it
+		return sysenterCall(num, a1, a2, a3, a4, a5);
 	asm volatile("movl %%eax, %0":"=m"(eax));
 	asm volatile("movl %%ecx, %0":"=m"(ecx));
 	asm volatile("movl %%edx, %0":"=m"(edx));
@@ -36,203 +75,39 @@ int32_t syscall(int num, uint32_t a1,uint32_t a2,
 	return ret;
 }
 
-int dec2Str(int decimal, char *buffer, int size, int count);
-int hex2Str(uint32_t hexadecimal, char *buffer, int size, int count);
-int str2Str(char *string, char *buffer, int size, int count);
-
-int printf(const char *format,...){
-	int i=0; // format index
-	char buffer[MAX_BUFFER_SIZE];
-	int count=0; // buffer index
-	int index=0; // parameter index
-	void *paraList=(void*)&format; // address of format in stack
-	int state=0; // 0: legal character; 1: '%'; 2: illegal format
-	int decimal=0;
-	uint32_t hexadecimal=0;
-	char *string=0;
-	char character=0;
-	while(format[i]!=0){
-		switch(state){
-			case 0:
-				switch(format[i]){
-					case '%': // '%' inputed
-						state = 1;
-						break;
-					default: // other character inputed
-						state = 0;
-						buffer[count]=format[i];
-						count++;
-						break;
-				}
-				break;
-			case 1: // '%' is on top of stack
-				switch(format[i]){
-					case '%':
-						state = 0;
-						buffer[count]='%';
-						count++;
-						break;
-					case 'd':
-						state = 0;
-						index+=4;
-						decimal=*(int*)(paraList+index);
-						count=dec2Str(decimal, buffer, MAX_BUFFER_SIZE, count);
-						break; // decimal
-      					case 'x':
-						state = 0;
-						index+=4;
-						hexadecimal=*(uint32_t*)(paraList+index);
-						count=hex2Str(hexadecimal, buffer, MAX_BUFFER_SIZE, count);
-						break; // hexadecimal
-					case 's':
-						state = 0;
-						index+=4;
-						string=*(char**)(paraList+index);
-						count=str2Str(string, buffer, MAX_BUFFER_SIZE, count);
-						break; // string
-					case 'c':
-						state = 0;
-						index+=4;
-						character=*(char*)(paraList+index);
-						buffer[count]=character;
-						count++;
-						break; // character
-					default:
-						state = 2;
-						break;
-				}
-				break;
-			case 2:
-				break;
-			default:break;
-		}
-		if(state==2)
-			break;
-		if(count==MAX_BUFFER_SIZE) {
-			syscall(SYS_WRITE, STD_OUT, (uint32_t)buffer, (uint32_t)MAX_BUFFER_SIZE, 0, 0);
-			count=0;
-		}
-		i++;
-	}
-	if(count!=0)
-		syscall(SYS_WRITE, STD_OUT, (uint32_t)buffer, (uint32_t)count, 0, 0);
-	return 0;
-}
-
-int dec2Str(int decimal, char *buffer, int size, int count) {
-	int i=0;
-	int temp;
-	int number[16];
-
-	if(decimal<0){
-		buffer[count]='-';
-		count++;
-		if(count==size) {
-			syscall(SYS_WRITE, STD_OUT, (uint32_t)buffer, (uint32_t)size, 0, 0);
-			count=0;
-		}
-		temp=decimal/10;
-		number[i]=temp*10-decimal;
-		decimal=temp;
-		i++;
-		while(decimal!=0){
-			temp=decimal/10;
-			number[i]=temp*10-decimal;
-			decimal=temp;
-			i++;
-		}
-	}
-	else{
-		temp=decimal/10;
-		number[i]=decimal-temp*10;
-		decimal=temp;
-		i++;
-		while(decimal!=0){
-			temp=decimal/10;
-			number[i]=decimal-temp*10;
-			decimal=temp;
-			i++;
-		}
-	}
-
-	while(i!=0){
-		buffer[count]=number[i-1]+'0';
-		count++;
-		if(count==size) {
-			syscall(SYS_WRITE, STD_OUT, (uint32_t)buffer, (uint32_t)size, 0, 0);
-			count=0;
-		}
-		i--;
-	}
-	return count;
+static void printfWrite(void *arg, const char *s, int n) {
+	fwrite(s, 1, n, (FILE *)arg);
 }
 
-int hex2Str(uint32_t hexadecimal, char *buffer, int size, int count) {
-	int i=0;
-	uint32_t temp=0;
-	int number[16];
-
-	temp=hexadecimal>>4;
-	number[i]=hexadecimal-(temp<<4);
-	hexadecimal=temp;
-	i++;
-	while(hexadecimal!=0){
-		temp=hexadecimal>>4;
-		number[i]=hexadecimal-(temp<<4);
-		hexadecimal=temp;
-		i++;
-	}
-
-	while(i!=0){
-		if(number[i-1]<10)
-			buffer[count]=number[i-1]+'0';
-		else
-			buffer[count]=number[i-1]-10+'a';
-		count++;
-		if(count==size) {
-			syscall(SYS_WRITE, STD_OUT, (uint32_t)buffer, (uint32_t)size, 0, 0);
-			count=0;
-		}
-		i--;
-	}
-	return count;
-}
-
-int str2Str(char *string, char *buffer, int size, int count) {
-	int i=0;
-	while(string[i]!=0){
-		buffer[count]=string[i];
-		count++;
-		if(count==size) {
-			syscall(SYS_WRITE, STD_OUT, (uint32_t)buffer, (uint32_t)size, 0, 0);
-			count=0;
-		}
-		i++;
-	}
-	return count;
+int printf(const char *format,...){
+	va_list ap;
+	int n;
+	va_start(ap, format);
+	n = vformat(printfWrite, stdout, format, ap);
+	va_end(ap);
+	return n;
 }
 
-int matchWhiteSpace(char *buffer, int size, int *count);
-int str2Dec(int *dec, char *buffer, int size, int *count);
-int str2Hex(int *hex, char *buffer, int size, int *count);
-int str2Str2(char *string, int avail, char *buffer, int size, int *count);
+int fillBuffer(FILE *stream);
+int matchWhiteSpace(char *buffer, int *count);
+int str2Dec(int *dec, char *buffer, int *count);
+int str2Hex(int *hex, char *buffer, int *count);
+int str2Str2(char *string, int avail, char *buffer, int *count);
 
-int scanf(const char *format,...) {
+/* parses stdin's buffer in place, whatever is not matched stays in it */
+static int vscanf(const char *format, va_list ap) {
 	int i=0;
-	char buffer[MAX_BUFFER_SIZE];
-	int count=0; // buffer index
-	int index=0; // parameter index
-	void *paraList=(void*)&format;
+	char *buffer=stdin->buf;
+	int *count=&stdin->pos; // buffer index
+	int index=0; // parameters filled in
 	int state=0; // 0: legal character; 1: '%'; 2: string width;
 	int avail=0; // string size
 	int ret=0;
-	buffer[0]=0;
 	while(format[i]!=0){
-		if(buffer[count]==0){
-			do{
-				ret=syscall(SYS_READ, STD_IN, (uint32_t)buffer, (uint32_t)MAX_BUFFER_SIZE, 0, 0);
-			}while(ret == 0 || ret == -1);
-			count=0;
+		if(buffer[*count]==0){
+			ret=fillBuffer(stdin);//阻塞到读入一整行
+			if(ret <= 0)
+				return index;
 		}
 		switch(state){
 			case 0:
@@ -244,14 +119,14 @@ int scanf(const char *format,...) {
 					case '\t':
 					case '\n':
 						state = 0;
-						matchWhiteSpace(buffer, MAX_BUFFER_SIZE, &count);
+						matchWhiteSpace(buffer, count);
 						break;
 					default:
-						if(format[i]!=buffer[count])
-							return index/4;
+						if(format[i]!=buffer[*count])
+							return index;
 						else{
 							state=0;
-							count++;
+							(*count)++;
 							break;
 						}
 				}
@@ -259,34 +134,34 @@ int scanf(const char *format,...) {
 			case 1:
 				switch(format[i]){
 					case '%':
-						if(format[i]!=buffer[count])
-							return index/4;
+						if(format[i]!=buffer[*count])
+							return index;
 						else{
 							state=0;
-							count++;
+							(*count)++;
 							break;
 						}
 					case 'd':
 						state = 0;
-						index+=4;
-						ret=str2Dec(*(int**)(paraList+index), buffer, MAX_BUFFER_SIZE, &count);
+						index++;
+						ret=str2Dec(va_arg(ap, int*), buffer, count);
 						if(ret==-1)
-							return (index-4)/4;
+							return index-1;
 						else
 							break;
 					case 'x':
 						state = 0;
-						index+=4;
-						ret=str2Hex(*(int**)(paraList+index), buffer, MAX_BUFFER_SIZE, &count);
+						index++;
+						ret=str2Hex(va_arg(ap, int*), buffer, count);
 						if(ret==-1)
-							return (index-4)/4;
+							return index-1;
 						else
 							break;
 					case 'c':
 						state = 0;
-						index+=4;
-						*(*(char**)(paraList+index))=buffer[count];
-						count++;
+						index++;
+						*va_arg(ap, char*)=buffer[*count];
+						(*count)++;
 						break;
 					case '0':
 					case '1':
@@ -303,7 +178,7 @@ int scanf(const char *format,...) {
 						avail+=format[i]-'0';
 						break;
 					default:
-						return index/4;
+						return index;
 				}
 				break;
 			case 2:
@@ -324,32 +199,40 @@ int scanf(const char *format,...) {
 						break;
 					case 's':
 						state = 0;
-						index+=4;
-						ret=str2Str2(*(char**)(paraList+index), avail, buffer, MAX_BUFFER_SIZE, &count);
+						index++;
+						ret=str2Str2(va_arg(ap, char*), avail, buffer, count);
 						if(ret==-1)
-							return (index-4)/4;
+							return index-1;
 						else
 							break;
 					default:
-						return index/4;
+						return index;
 				}
 				break;
 			default:
-				return index/4;
+				return index;
 		}
 		i++;
 	}
-	return index/4;
+	return index;
+}
+
+int scanf(const char *format,...) {
+	va_list ap;
+	int ret;
+	va_start(ap, format);
+	ret=vscanf(format, ap);
+	va_end(ap);
+	return ret;
 }
 
-int matchWhiteSpace(char *buffer, int size, int *count){
+int matchWhiteSpace(char *buffer, int *count){
 	int ret=0;
 	while(1){
 		if(buffer[*count]==0){
-			do{
-				ret=syscall(SYS_READ, STD_IN, (uint32_t)buffer, (uint32_t)size, 0, 0);
-			}while(ret == 0 || ret == -1);
-			(*count)=0;
+			ret=fillBuffer(stdin);
+			if(ret <= 0)
+				return -1;
 		}
 		if(buffer[*count]==' ' ||
 		   buffer[*count]=='\t' ||
@@ -361,17 +244,16 @@ int matchWhiteSpace(char *buffer, int size, int *count){
 	}
 }
 
-int str2Dec(int *dec, char *buffer, int size, int *count) {
+int str2Dec(int *dec, char *buffer, int *count) {
 	int sign=0; // positive integer
 	int state=0;
 	int integer=0;
 	int ret=0;
 	while(1){
 		if(buffer[*count]==0){
-			do{
-				ret=syscall(SYS_READ, STD_IN, (uint32_t)buffer, (uint32_t)size, 0, 0);
-			}while(ret == 0 || ret == -1);
-			(*count)=0;
+			ret=fillBuffer(stdin);
+			if(ret <= 0)
+				return -1;
 		}
 		if(state==0){
 			if(buffer[*count]=='-'){
@@ -426,16 +308,15 @@ int str2Dec(int *dec, char *buffer, int size, int *count) {
 	return 0;
 }
 
-int str2Hex(int *hex, char *buffer, int size, int *count) {
+int str2Hex(int *hex, char *buffer, int *count) {
 	int state=0;
 	int integer=0;
 	int ret=0;
 	while(1){
 		if(buffer[*count]==0){
-			do{
-				ret=syscall(SYS_READ, STD_IN, (uint32_t)buffer, (uint32_t)size, 0, 0);
-			}while(ret == 0 || ret == -1);
-			(*count)=0;
+			ret=fillBuffer(stdin);
+			if(ret <= 0)
+				return -1;
 		}
 		if(state==0){
 			if(buffer[*count]=='0'){
@@ -511,16 +392,15 @@ int str2Hex(int *hex, char *buffer, int size, int *count) {
 	return 0;
 }
 
-int str2Str2(char *string, int avail, char *buffer, int size, int *count) {
+int str2Str2(char *string, int avail, char *buffer, int *count) {
 	int i=0;
 	int state=0;
 	int ret=0;
 	while(i < avail-1){
 		if(buffer[*count]==0){
-			do{
-				ret=syscall(SYS_READ, STD_IN, (uint32_t)buffer, (uint32_t)size, 0, 0);
-			}while(ret == 0 || ret == -1);
-			(*count)=0;
+			ret=fillBuffer(stdin);
+			if(ret <= 0)
+				return -1;
 		}
 		if(state==0){
 			if(buffer[*count]==' ' ||
@@ -557,7 +437,58 @@ int str2Str2(char *string, int avail, char *buffer, int size, int *count) {
 	return 0;
 }
 
+int write(int fd, const void *buf, uint32_t size) {
+	return syscall(SYS_WRITE, (uint32_t)fd, (uint32_t)buf, size, 0, 0);
+}
+
+int read(int fd, void *buf, uint32_t size) {
+	return syscall(SYS_READ, (uint32_t)fd, (uint32_t)buf, size, 0, 0);
+}
+
+int pipe(int fd[2]) {
+	return syscall(SYS_PIPE, (uint32_t)fd, 0, 0, 0, 0);
+}
+
+int poll(struct pollfd *fds, uint32_t n, int timeout) {
+	return syscall(SYS_POLL, (uint32_t)fds, n, (uint32_t)timeout, 0, 0);
+}
+
+int console_mode(int mode) {
+	return syscall(SYS_CONSOLE, (uint32_t)mode, 0, 0, 0, 0);
+}
+
+int klog(char *buf, uint32_t size) {
+	return syscall(SYS_KLOG, (uint32_t)buf, size, 0, 0, 0);
+}
+
+int close(int fd) {
+	return syscall(SYS_CLOSE, (uint32_t)fd, 0, 0, 0, 0);
+}
+
+/* ipc messages travel in registers, which syscall() saves and restores */
+static int32_t ipcTrap(uint32_t op, uint32_t pid, struct ipcmsg *msg) {
+	int32_t ret = 0;
+	uint32_t w0 = msg->w[0], w1 = msg->w[1], w2 = msg->w[2];
+	asm volatile("int $0x80"
+		: "=a"(ret), "+b"(w0), "+S"(w1), "+D"(w2)
+		: "a"(SYS_IPC), "c"(op), "d"(pid)
+		: "memory");
+	msg->w[0] = w0;
+	msg->w[1] = w1;
+	msg->w[2] = w2;
+	return ret;
+}
+
+int ipc_call(pid_t dst, struct ipcmsg *msg) {
+	return ipcTrap(IPC_CALL, (uint32_t)dst, msg);
+}
+
+pid_t ipc_reply_wait(pid_t client, struct ipcmsg *msg) {
+	return ipcTrap(IPC_REPLY_WAIT, (uint32_t)client, msg);
+}
+
 pid_t fork() {
+	fflush(0); // the child would print the pending output a second time
 	return syscall(SYS_FORK, 0, 0, 0, 0, 0);
 }
 
@@ -569,7 +500,93 @@ int sleep(uint32_t time) {
 	return syscall(SYS_SLEEP, (uint32_t)time, 0, 0, 0, 0);
 }
 
+void *sbrk(int32_t incr) {
+	return (void *)syscall(SYS_SBRK, (uint32_t)incr, 0, 0, 0, 0);
+}
+
+int ring_setup(struct ring *r) {
+	return syscall(SYS_RING, RING_SETUP, (uint32_t)r, 0, 0, 0);
+}
+
+int ring_push(struct ring *r, uint32_t op, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t data) {
+	struct ringsqe *e;
+	if (r->sqtail - r->sqhead >= RING_SIZE)
+		return -1;
+	e = &r->sq[r->sqtail % RING_SIZE];
+	e->op = op;
+	e->a1 = a1;
+	e->a2 = a2;
+	e->a3 = a3;
+	e->data = data;
+	r->sqtail++;
+	return 0;
+}
+
+int ring_enter() {
+	return syscall(SYS_RING, RING_ENTER, 0, 0, 0, 0);
+}
+
+int ring_pop(struct ring *r, struct ringcqe *c) {
+	if (r->cqhead == r->cqtail)
+		return 0;
+	*c = r->cq[r->cqhead % RING_SIZE];
+	r->cqhead++;
+	return 1;
+}
+
+pid_t getpid() {
+	return VDSO_PROC->pid;
+}
+
+uint32_t get_ticks() {
+	return VDSO->ticks;
+}
+
+/* the kernel only writes the page between two seq increments, so an even seq
+ * that is the same after the copy means nothing changed in between */
+void vdso_read(struct vdso *copy) {
+	uint32_t seq;
+	do {
+		while ((seq = VDSO->seq) & 1);
+		copy->seq = seq;
+		copy->hz = VDSO->hz;
+		copy->ticks = VDSO->ticks;
+		copy->tsclow = VDSO->tsclow;
+		copy->tschigh = VDSO->tschigh;
+		copy->tscpertick = VDSO->tscpertick;
+		copy->switches = VDSO->switches;
+		copy->idleticks = VDSO->idleticks;
+		copy->runnable = VDSO->runnable;
+		copy->blocked = VDSO->blocked;
+	} while (VDSO->seq != seq);
+}
+
+uint64_t uptime_us() {
+	uint32_t seq, ticks, tsc, perus, now, high, us;
+	uint32_t tickus = 1000000 / VDSO->hz;
+	do {
+		seq = VDSO->seq;
+		ticks = VDSO->ticks;
+		tsc = VDSO->tsclow;
+		perus = VDSO->tscpertick / tickus; // TSC cycles per microsecond
+		if (perus != 0)
+			asm volatile("rdtsc" : "=a"(now), "=d"(high));
+	} while (VDSO->seq != seq);
+	us = 0;
+	if (perus != 0) {
+		us = (now - tsc) / perus;
+		if (us >= tickus) // the next tick is late, do not run ahead of it
+			us = tickus - 1;
+	}
+	return (uint64_t)ticks * tickus + us;
+}
+
+static int semProfile = 0;
+
 int exit() {
+	if (semProfile)
+		sem_dump();
+	fflush(0);
 	return syscall(SYS_EXIT, 0, 0, 0, 0, 0);
 }
 
@@ -587,9 +604,96 @@ int sem_wait(sem_t *sem) {
 }
 //V
 int sem_post(sem_t *sem) {
-	return syscall(SYS_SEM, SEM_POST, *sem, 0, 0, 0);
+	return syscall(SYS_SEM, SEM_POST, *sem, SEM_WAKE, 0, 0);
+}
+
+int sem_post_handoff(sem_t *sem) {
+	return syscall(SYS_SEM, SEM_POST, *sem, SEM_HANDOFF, 0, 0);
 }
 
 int sem_destroy(sem_t *sem) {
 	return syscall(SYS_SEM, SEM_DESTROY, *sem, 0, 0, 0);
 }
+
+int sem_timedwait(sem_t *sem, uint32_t ticks) {
+	return syscall(SYS_SEM, SEM_TIMEDWAIT, *sem, ticks, 0, 0);
+}
+
+int sem_trywait(sem_t *sem) {
+	return syscall(SYS_SEM, SEM_TRYWAIT, *sem, 0, 0, 0);
+}
+
+int semop(struct sembuf *ops, uint32_t n) {
+	return syscall(SYS_SEM, SEM_OP, (uint32_t)ops, n, 0, 0);
+}
+
+int sem_stat(int index, struct semstat *st) {
+	return syscall(SYS_SEM, SEM_STAT, (uint32_t)index, (uint32_t)st, 0, 0);
+}
+
+void sem_dump() {
+	struct semstat st;
+	int i, j;
+	for (i = 0; sem_stat(i, &st) != -1; i++) {
+		if (st.waits == 0 && st.posts == 0)
+			continue;
+		printf("sem %d: waits %d contended %d posts %d maxqueue %d blocked %d ticks\n",
+			i, st.waits, st.contended, st.posts, st.maxqueue, st.blockedticks);
+		printf("  ticks 0:%d 1:%d", st.hist[0], st.hist[1]);
+		for (j = 2; j < SEM_HIST_NUM - 1; j++)
+			printf(" %d-%d:%d", 1 << (j-1), (1 << j) - 1, st.hist[j]);
+		printf(" %d+:%d\n", 1 << (SEM_HIST_NUM-2), st.hist[SEM_HIST_NUM-1]);
+	}
+}
+
+void sem_profile(int on) {
+	semProfile = on;
+}
+
+int futex_wait(volatile int32_t *addr) {
+	return syscall(SYS_FUTEX, FUTEX_WAIT, (uint32_t)addr, 0, 0, 0);
+}
+
+int futex_wake(volatile int32_t *addr) {
+	return syscall(SYS_FUTEX, FUTEX_WAKE, (uint32_t)addr, 0, 0, 0);
+}
+
+int fsem_init(fsem_t *sem, int32_t value) {
+	if (value < 0)
+		return -1;
+	*sem = value;
+	return 0;
+}
+
+//P: count<0 after the decrement means someone has to sleep in the kernel
+int fsem_wait(fsem_t *sem) {
+	uint8_t negative = 0;
+	asm volatile("lock; decl %0; sets %1":"+m"(*sem), "=q"(negative)::"memory", "cc");
+	if (negative == 0)
+		return 0;
+	if (futex_wait(sem) == -1) { // no futex slot: give the unit back
+		asm volatile("lock; incl %0":"+m"(*sem)::"memory", "cc");
+		return -1;
+	}
+	return 0;
+}
+//V: count<=0 after the increment means someone is (or is about to be) asleep
+int fsem_post(fsem_t *sem) {
+	uint8_t waiters = 0;
+	asm volatile("lock; incl %0; setle %1":"+m"(*sem), "=q"(waiters)::"memory", "cc");
+	if (waiters == 0)
+		return 0;
+	return futex_wake(sem);
+}
+
+int shm_create(uint32_t size) {
+	return syscall(SYS_SHM, SHM_CREATE, size, 0, 0, 0);
+}
+
+void *shm_attach(int id) {
+	return (void *)syscall(SYS_SHM, SHM_ATTACH, (uint32_t)id, 0, 0, 0);
+}
+
+int shm_detach(int id) {
+	return syscall(SYS_SHM, SHM_DETACH, (uint32_t)id, 0, 0, 0);
+}
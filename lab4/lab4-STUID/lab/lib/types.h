@@ -8,9 +8,92 @@ typedef          short int16_t;
 typedef unsigned char  uint8_t;
 typedef          char  int8_t;
 typedef unsigned char  boolean;
+typedef unsigned long long uint64_t;
+typedef          long long int64_t;
 
 typedef uint32_t size_t;
 typedef int32_t  pid_t;
 typedef int32_t sem_t;
+typedef volatile int32_t fsem_t;
+
+struct ipcmsg {
+	uint32_t w[3]; // travels in ebx, esi, edi
+};
+
+struct sembuf {
+	sem_t sem;
+	int32_t op; // <0: wait -op units; >0: post op units
+};
+
+/* read-only kernel data at VDSO_BASE, the same page in every process */
+struct vdso {
+	uint32_t seq; // odd while the kernel is updating the page
+	uint32_t hz; // ticks per second
+	uint32_t ticks; // timer ticks since boot
+	uint32_t tsclow, tschigh; // TSC at the last tick
+	uint32_t tscpertick; // 0 until calibrated, or without a TSC
+	uint32_t switches; // process switches since boot
+	uint32_t idleticks; // ticks that found the idle process running
+	uint32_t runnable; // user processes ready or running at the last tick
+	uint32_t blocked; // and blocked
+};
+
+/* at VDSO_BASE+0x1000, this process's own */
+struct vdsoproc {
+	uint32_t pid;
+	uint32_t ticks; // ticks that found this process running
+	uint32_t switches; // times it was switched to
+};
+
+#define BUFSIZ 1024
+
+struct FILE {
+	int fd; // -1: slot unused
+	int mode; // _IOFBF, _IOLBF or _IONBF
+	int count; // bytes waiting in buf, or read into it while reading
+	int size;
+	char *buf;
+	int pos; // reading: buf[pos..count) is not consumed yet
+	int reading; // buf holds input instead of pending output
+};
+typedef struct FILE FILE;
+
+struct pollfd {
+	int32_t fd; // file descriptor, or sem_t when events has POLLSEM
+	int32_t events;
+	int32_t revents; // filled in by poll
+};
+
+#define RING_SIZE 16
+
+struct ringsqe {
+	uint32_t op;
+	uint32_t a1, a2, a3;
+	uint32_t data; // handed back in the completion
+};
+
+struct ringcqe {
+	int32_t res; // what the system call returned
+	uint32_t data;
+};
+
+/* the process moves sqtail and cqhead, the kernel sqhead and cqtail */
+struct ring {
+	volatile uint32_t sqhead, sqtail;
+	volatile uint32_t cqhead, cqtail;
+	struct ringsqe sq[RING_SIZE];
+	struct ringcqe cq[RING_SIZE];
+};
+
+#define SEM_HIST_NUM 8
+
+struct semstat {
+	uint32_t waits;
+	uint32_t contended; // times a waiter had to block
+	uint32_t posts;
+	uint32_t maxqueue; // most processes blocked at once
+	uint32_t blockedticks;
+	uint32_t hist[SEM_HIST_NUM]; // waits that took 0, 1, 2-3, 4-7, ..., 64+ ticks
+};
 
 #endif